@@ -0,0 +1,117 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "address_map.h"
+
+static int compare_entries(const void *a, const void *b)
+{
+  const AddressMapEntry *entry_a = (const AddressMapEntry *)a;
+  const AddressMapEntry *entry_b = (const AddressMapEntry *)b;
+
+  if (entry_a->address < entry_b->address) { return -1; }
+  if (entry_a->address > entry_b->address) { return 1; }
+
+  return 0;
+}
+
+void address_map_init(AddressMap *address_map)
+{
+  memset(address_map, 0, sizeof(AddressMap));
+}
+
+void address_map_free(AddressMap *address_map)
+{
+  free(address_map->entries);
+
+  memset(address_map, 0, sizeof(AddressMap));
+}
+
+int address_map_add(AddressMap *address_map, MachoSegmentLoad *macho_segment_load)
+{
+  uint64_t size = macho_segment_load->file_size;
+
+  // Only the part of the segment that is in the file can be translated,
+  // the rest (and all of __PAGEZERO) is zero filled at load time.
+  if (size > macho_segment_load->address_size)
+  {
+    size = macho_segment_load->address_size;
+  }
+
+  if (size == 0) { return 0; }
+
+  AddressMapEntry *entries = realloc(address_map->entries,
+    (address_map->count + 1) * sizeof(AddressMapEntry));
+  if (entries == NULL) { return -1; }
+
+  address_map->entries = entries;
+  address_map->entries[address_map->count].address = macho_segment_load->address;
+  address_map->entries[address_map->count].size = size;
+  address_map->entries[address_map->count].file_offset =
+    macho_segment_load->file_offset;
+  address_map->count++;
+  address_map->sorted = 0;
+
+  return 0;
+}
+
+// Finds the file offset of length bytes at address. The bytes have to be
+// inside a single segment. The table is sorted the first time it's used
+// so every lookup after that is a binary search.
+int address_map_translate(
+  AddressMap *address_map,
+  uint64_t address,
+  uint64_t length,
+  uint64_t *file_offset)
+{
+  int low = 0, high = address_map->count - 1, found = -1;
+
+  if (address_map->sorted == 0)
+  {
+    if (address_map->count > 1)
+    {
+      qsort(address_map->entries, address_map->count,
+        sizeof(AddressMapEntry), compare_entries);
+    }
+
+    address_map->sorted = 1;
+  }
+
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+
+    if (address_map->entries[middle].address <= address)
+    {
+      found = middle;
+      low = middle + 1;
+    }
+      else
+    {
+      high = middle - 1;
+    }
+  }
+
+  if (found < 0) { return -1; }
+
+  AddressMapEntry *entry = &address_map->entries[found];
+  uint64_t offset = address - entry->address;
+
+  if (offset >= entry->size || length > entry->size - offset) { return -1; }
+
+  *file_offset = entry->file_offset + offset;
+
+  return 0;
+}
+
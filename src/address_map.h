@@ -0,0 +1,43 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef ADDRESS_MAP_H
+#define ADDRESS_MAP_H
+
+#include <stdint.h>
+
+#include "macho.h"
+
+// The file backed part of one segment.
+typedef struct AddressMapEntry
+{
+  uint64_t address;
+  uint64_t size;
+  uint64_t file_offset;
+} AddressMapEntry;
+
+typedef struct AddressMap
+{
+  AddressMapEntry *entries;
+  int count;
+  int sorted;
+} AddressMap;
+
+void address_map_init(AddressMap *address_map);
+void address_map_free(AddressMap *address_map);
+int address_map_add(AddressMap *address_map, MachoSegmentLoad *macho_segment_load);
+int address_map_translate(
+  AddressMap *address_map,
+  uint64_t address,
+  uint64_t length,
+  uint64_t *file_offset);
+
+#endif
+
@@ -0,0 +1,935 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "code_signature.h"
+#include "parallel.h"
+#include "sha.h"
+
+// Pages are handed to the hashing threads in batches of about this many
+// bytes so each thread does one large pread() instead of one per page.
+#define VERIFY_BATCH_BYTES (1024 * 1024)
+
+#define PAGE_OK         0
+#define PAGE_MISMATCH   1
+#define PAGE_READ_ERROR 2
+
+typedef struct Requirement
+{
+  const uint8_t *data;
+  uint32_t length;
+  uint32_t offset;
+} Requirement;
+
+typedef struct VerifyJob
+{
+  int fd;
+  const uint8_t *hashes;
+  uint64_t code_limit;
+  uint32_t page_count;
+  uint32_t page_size;
+  uint32_t batch_pages;
+  int hash_type;
+  int hash_size;
+  uint8_t *page_status;
+} VerifyJob;
+
+static const char *requirement_type[] =
+{
+  "???",
+  "host",
+  "guest",
+  "designated",
+  "library",
+  "plugin",
+};
+
+static uint32_t get_uint32_be(const uint8_t *data)
+{
+  return ((uint32_t)data[0] << 24) |
+         ((uint32_t)data[1] << 16) |
+         ((uint32_t)data[2] << 8) |
+          (uint32_t)data[3];
+}
+
+static uint64_t get_uint64_be(const uint8_t *data)
+{
+  return ((uint64_t)get_uint32_be(data) << 32) | get_uint32_be(data + 4);
+}
+
+static const char *get_hash_type(int value)
+{
+  switch (value)
+  {
+    case CS_HASHTYPE_SHA1: return "SHA-1";
+    case CS_HASHTYPE_SHA256: return "SHA-256";
+    case CS_HASHTYPE_SHA256_TRUNCATED: return "SHA-256 (truncated)";
+    case CS_HASHTYPE_SHA384: return "SHA-384";
+    default: return "???";
+  }
+}
+
+static const char *get_requirement_type(uint32_t value)
+{
+  int max = sizeof(requirement_type) / sizeof(char *);
+  if (value >= max) { return "???"; }
+
+  return requirement_type[value];
+}
+
+static int is_hash_type_supported(int hash_type)
+{
+  return hash_type == CS_HASHTYPE_SHA1 ||
+         hash_type == CS_HASHTYPE_SHA256 ||
+         hash_type == CS_HASHTYPE_SHA256_TRUNCATED;
+}
+
+static int hash_page(int hash_type, uint8_t *digest, const uint8_t *data, uint64_t length)
+{
+  switch (hash_type)
+  {
+    case CS_HASHTYPE_SHA1:
+      sha1(digest, data, length);
+      return 0;
+    case CS_HASHTYPE_SHA256:
+    case CS_HASHTYPE_SHA256_TRUNCATED:
+      sha256(digest, data, length);
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+static void print_hash(const uint8_t *hash, int hash_size)
+{
+  int n;
+
+  for (n = 0; n < hash_size; n++) { printf("%02x", hash[n]); }
+}
+
+static int is_zero(const uint8_t *data, int length)
+{
+  int n;
+
+  for (n = 0; n < length; n++)
+  {
+    if (data[n] != 0) { return 0; }
+  }
+
+  return 1;
+}
+
+static void print_string(const uint8_t *blob, uint32_t length, uint32_t offset)
+{
+  uint32_t n;
+
+  if (offset == 0 || offset >= length)
+  {
+    printf("(none)");
+    return;
+  }
+
+  for (n = offset; n < length && blob[n] != 0; n++) { printf("%c", blob[n]); }
+}
+
+static int read_code_directory(
+  CodeDirectory *code_directory,
+  const uint8_t *blob,
+  uint32_t length)
+{
+  memset(code_directory, 0, sizeof(CodeDirectory));
+
+  if (length < 44) { return -1; }
+
+  code_directory->magic = get_uint32_be(blob + 0);
+  code_directory->length = get_uint32_be(blob + 4);
+  code_directory->version = get_uint32_be(blob + 8);
+  code_directory->flags = get_uint32_be(blob + 12);
+  code_directory->hash_offset = get_uint32_be(blob + 16);
+  code_directory->ident_offset = get_uint32_be(blob + 20);
+  code_directory->special_slot_count = get_uint32_be(blob + 24);
+  code_directory->code_slot_count = get_uint32_be(blob + 28);
+  code_directory->code_limit = get_uint32_be(blob + 32);
+  code_directory->hash_size = blob[36];
+  code_directory->hash_type = blob[37];
+  code_directory->platform = blob[38];
+  code_directory->page_size = blob[39];
+  code_directory->spare2 = get_uint32_be(blob + 40);
+
+  if (code_directory->length > length) { return -1; }
+
+  length = code_directory->length;
+
+  if (code_directory->version >= 0x20100 && length >= 48)
+  {
+    code_directory->scatter_offset = get_uint32_be(blob + 44);
+  }
+
+  if (code_directory->version >= 0x20200 && length >= 52)
+  {
+    code_directory->team_offset = get_uint32_be(blob + 48);
+  }
+
+  if (code_directory->version >= 0x20300 && length >= 64)
+  {
+    code_directory->spare3 = get_uint32_be(blob + 52);
+    code_directory->code_limit_64 = get_uint64_be(blob + 56);
+  }
+
+  if (code_directory->version >= 0x20400 && length >= 88)
+  {
+    code_directory->exec_seg_base = get_uint64_be(blob + 64);
+    code_directory->exec_seg_limit = get_uint64_be(blob + 72);
+    code_directory->exec_seg_flags = get_uint64_be(blob + 80);
+  }
+
+  // Make sure every hash slot (special slots are stored in front of
+  // hash_offset) is inside the blob before anything indexes into them.
+  uint64_t special_size =
+    (uint64_t)code_directory->special_slot_count * code_directory->hash_size;
+  uint64_t code_size =
+    (uint64_t)code_directory->code_slot_count * code_directory->hash_size;
+
+  if (code_directory->hash_offset < special_size ||
+      code_directory->hash_offset + code_size > length)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+static uint64_t get_code_limit(CodeDirectory *code_directory)
+{
+  if (code_directory->code_limit_64 != 0)
+  {
+    return code_directory->code_limit_64;
+  }
+
+  return code_directory->code_limit;
+}
+
+static void print_code_directory(CodeDirectory *code_directory, const uint8_t *blob)
+{
+  const uint8_t *hashes = blob + code_directory->hash_offset;
+  int hash_size = code_directory->hash_size;
+  int n;
+
+  printf(" -- Code Directory --\n");
+  printf("             magic: 0x%08x\n", code_directory->magic);
+  printf("            length: %d\n", code_directory->length);
+  printf("           version: 0x%05x\n", code_directory->version);
+  printf("             flags: 0x%04x\n", code_directory->flags);
+  printf("       hash_offset: %d\n", code_directory->hash_offset);
+  printf("      ident_offset: %d (", code_directory->ident_offset);
+  print_string(blob, code_directory->length, code_directory->ident_offset);
+  printf(")\n");
+  printf("special_slot_count: %d\n", code_directory->special_slot_count);
+  printf("   code_slot_count: %d\n", code_directory->code_slot_count);
+  printf("        code_limit: %d\n", code_directory->code_limit);
+  printf("         hash_size: %d\n", code_directory->hash_size);
+  printf("         hash_type: %d (%s)\n",
+    code_directory->hash_type,
+    get_hash_type(code_directory->hash_type));
+  printf("          platform: %d\n", code_directory->platform);
+  printf("         page_size: %d (%d bytes)\n",
+    code_directory->page_size,
+    code_directory->page_size == 0 || code_directory->page_size >= 32 ?
+      0 : 1 << code_directory->page_size);
+
+  if (code_directory->version >= 0x20100)
+  {
+    printf("    scatter_offset: %d\n", code_directory->scatter_offset);
+  }
+
+  if (code_directory->version >= 0x20200)
+  {
+    printf("       team_offset: %d (", code_directory->team_offset);
+    print_string(blob, code_directory->length, code_directory->team_offset);
+    printf(")\n");
+  }
+
+  if (code_directory->version >= 0x20300)
+  {
+    printf("     code_limit_64: %ld\n", code_directory->code_limit_64);
+  }
+
+  if (code_directory->version >= 0x20400)
+  {
+    printf("     exec_seg_base: 0x%lx\n", code_directory->exec_seg_base);
+    printf("    exec_seg_limit: %ld\n", code_directory->exec_seg_limit);
+    printf("    exec_seg_flags: 0x%lx\n", code_directory->exec_seg_flags);
+  }
+
+  printf("\n");
+
+  for (n = code_directory->special_slot_count; n > 0; n--)
+  {
+    printf("  %3d) ", -n);
+    print_hash(hashes - (n * hash_size), hash_size);
+    printf("\n");
+  }
+
+  for (n = 0; n < code_directory->code_slot_count; n++)
+  {
+    printf("  %3d) ", n);
+    print_hash(hashes + (n * hash_size), hash_size);
+    printf("\n");
+  }
+
+  printf("\n");
+}
+
+static int requirement_get_uint32(Requirement *requirement, uint32_t *value)
+{
+  if (requirement->offset + 4 > requirement->length) { return -1; }
+
+  *value = get_uint32_be(requirement->data + requirement->offset);
+  requirement->offset += 4;
+
+  return 0;
+}
+
+static int requirement_get_data(
+  Requirement *requirement,
+  const uint8_t **data,
+  uint32_t *length)
+{
+  if (requirement_get_uint32(requirement, length) != 0) { return -1; }
+  if (*length > requirement->length - requirement->offset) { return -1; }
+
+  *data = requirement->data + requirement->offset;
+
+  // Data is padded to a 4 byte boundary.
+  requirement->offset += (*length + 3) & ~3;
+  if (requirement->offset > requirement->length)
+  {
+    requirement->offset = requirement->length;
+  }
+
+  return 0;
+}
+
+static int requirement_print_data(Requirement *requirement)
+{
+  const uint8_t *data;
+  uint32_t length, n;
+  int printable = 1;
+
+  if (requirement_get_data(requirement, &data, &length) != 0) { return -1; }
+
+  for (n = 0; n < length; n++)
+  {
+    if (data[n] < 0x20 || data[n] > 0x7e) { printable = 0; break; }
+  }
+
+  if (printable && length != 0)
+  {
+    printf("\"%.*s\"", length, data);
+  }
+    else
+  {
+    printf("H\"");
+    print_hash(data, length);
+    printf("\"");
+  }
+
+  return 0;
+}
+
+static int requirement_print_oid(Requirement *requirement)
+{
+  const uint8_t *data;
+  uint32_t length, n;
+  uint64_t value = 0;
+
+  if (requirement_get_data(requirement, &data, &length) != 0) { return -1; }
+  if (length == 0) { return 0; }
+
+  printf("%d.%d", data[0] / 40, data[0] % 40);
+
+  for (n = 1; n < length; n++)
+  {
+    value = (value << 7) | (data[n] & 0x7f);
+
+    if ((data[n] & 0x80) == 0)
+    {
+      printf(".%ld", value);
+      value = 0;
+    }
+  }
+
+  return 0;
+}
+
+static int requirement_print_cert_slot(Requirement *requirement)
+{
+  uint32_t slot;
+
+  if (requirement_get_uint32(requirement, &slot) != 0) { return -1; }
+
+  switch ((int32_t)slot)
+  {
+    case 0: printf("certificate leaf"); break;
+    case -1: printf("certificate root"); break;
+    default: printf("certificate %d", (int32_t)slot); break;
+  }
+
+  return 0;
+}
+
+static int requirement_print_match(Requirement *requirement)
+{
+  uint32_t match;
+
+  if (requirement_get_uint32(requirement, &match) != 0) { return -1; }
+
+  switch (match)
+  {
+    case 0: printf(" /* exists */"); return 0;
+    case 1: printf(" = "); break;
+    case 2: printf(" ~ "); break;
+    case 3: printf(" = "); break;
+    case 4: printf(" = *"); break;
+    case 5: printf(" < "); break;
+    case 6: printf(" > "); break;
+    case 7: printf(" <= "); break;
+    case 8: printf(" >= "); break;
+    case 9:
+    case 10:
+    case 11:
+    case 12:
+    case 13:
+    {
+      // Timestamps are 64 bit seconds since January 1, 2001.
+      const char *compare[] = { "=", "<", ">", "<=", ">=" };
+
+      if (requirement->offset + 8 > requirement->length) { return -1; }
+
+      printf(" %s timestamp %ld",
+        compare[match - 9],
+        (int64_t)get_uint64_be(requirement->data + requirement->offset));
+
+      requirement->offset += 8;
+
+      return 0;
+    }
+    case 14: printf(" absent"); return 0;
+    default: printf(" /* match %d? */", match); return -1;
+  }
+
+  if (requirement_print_data(requirement) != 0) { return -1; }
+
+  // matchBeginsWith prints as "prefix"* and matchEndsWith as *"suffix".
+  if (match == 3) { printf("*"); }
+
+  return 0;
+}
+
+static int requirement_print_expression(Requirement *requirement, int depth)
+{
+  uint32_t op;
+
+  if (depth > 64) { return -1; }
+  if (requirement_get_uint32(requirement, &op) != 0) { return -1; }
+
+  switch (op & 0x00ffffff)
+  {
+    case 0: printf("never"); return 0;
+    case 1: printf("always"); return 0;
+    case 2:
+      printf("identifier ");
+      return requirement_print_data(requirement);
+    case 3: printf("anchor apple"); return 0;
+    case 4:
+      if (requirement_print_cert_slot(requirement) != 0) { return -1; }
+      printf(" = ");
+      return requirement_print_data(requirement);
+    case 5:
+      printf("info[");
+      if (requirement_print_data(requirement) != 0) { return -1; }
+      printf("] = ");
+      return requirement_print_data(requirement);
+    case 6:
+    case 7:
+      printf("(");
+      if (requirement_print_expression(requirement, depth + 1) != 0)
+      {
+        return -1;
+      }
+      printf((op & 0x00ffffff) == 6 ? " and " : " or ");
+      if (requirement_print_expression(requirement, depth + 1) != 0)
+      {
+        return -1;
+      }
+      printf(")");
+      return 0;
+    case 8:
+      printf("cdhash ");
+      return requirement_print_data(requirement);
+    case 9:
+      printf("! ");
+      return requirement_print_expression(requirement, depth + 1);
+    case 10:
+      printf("info[");
+      if (requirement_print_data(requirement) != 0) { return -1; }
+      printf("]");
+      return requirement_print_match(requirement);
+    case 11:
+      if (requirement_print_cert_slot(requirement) != 0) { return -1; }
+      printf("[");
+      if (requirement_print_data(requirement) != 0) { return -1; }
+      printf("]");
+      return requirement_print_match(requirement);
+    case 12:
+      if (requirement_print_cert_slot(requirement) != 0) { return -1; }
+      printf(" trusted");
+      return 0;
+    case 13: printf("anchor trusted"); return 0;
+    case 14:
+    case 17:
+    case 22:
+      if (requirement_print_cert_slot(requirement) != 0) { return -1; }
+      switch (op & 0x00ffffff)
+      {
+        case 14: printf("[field."); break;
+        case 17: printf("[policy."); break;
+        default: printf("[timestamp."); break;
+      }
+      if (requirement_print_oid(requirement) != 0) { return -1; }
+      printf("]");
+      return requirement_print_match(requirement);
+    case 15: printf("anchor apple generic"); return 0;
+    case 16:
+      printf("entitlement[");
+      if (requirement_print_data(requirement) != 0) { return -1; }
+      printf("]");
+      return requirement_print_match(requirement);
+    case 18:
+      printf("anchor apple ");
+      return requirement_print_data(requirement);
+    case 19:
+      printf("(");
+      if (requirement_print_data(requirement) != 0) { return -1; }
+      printf(")");
+      return 0;
+    case 20:
+    {
+      uint32_t platform;
+      if (requirement_get_uint32(requirement, &platform) != 0) { return -1; }
+      printf("platform = %d", platform);
+      return 0;
+    }
+    case 21: printf("notarized"); return 0;
+    case 23: printf("legacy"); return 0;
+    default:
+      // Unknown ops flagged as skippable carry their length in front.
+      if ((op & 0x40000000) != 0)
+      {
+        const uint8_t *data;
+        uint32_t length;
+
+        printf("/* op 0x%x */", op);
+        return requirement_get_data(requirement, &data, &length);
+      }
+
+      printf("/* op 0x%x? */", op);
+      return -1;
+  }
+}
+
+static void print_requirements(const uint8_t *blob, uint32_t length)
+{
+  uint32_t count, n;
+
+  printf(" -- Requirements --\n");
+
+  if (length < 12)
+  {
+    printf("Error: Requirements blob is truncated.\n\n");
+    return;
+  }
+
+  count = get_uint32_be(blob + 8);
+
+  printf("  count: %d\n", count);
+
+  for (n = 0; n < count && 12 + (n * 8) + 8 <= length; n++)
+  {
+    uint32_t type = get_uint32_be(blob + 12 + (n * 8));
+    uint32_t offset = get_uint32_be(blob + 12 + (n * 8) + 4);
+
+    printf("  %d) %s ", type, get_requirement_type(type));
+
+    if (offset > length - 12 || get_uint32_be(blob + offset) != CSMAGIC_REQUIREMENT)
+    {
+      printf("(bad requirement at %d)\n", offset);
+      continue;
+    }
+
+    uint32_t requirement_length = get_uint32_be(blob + offset + 4);
+    uint32_t kind = get_uint32_be(blob + offset + 8);
+
+    if (requirement_length > length - offset) { requirement_length = length - offset; }
+
+    if (kind != 1)
+    {
+      printf("(kind %d, %d bytes)\n", kind, requirement_length);
+      continue;
+    }
+
+    Requirement requirement;
+    requirement.data = blob + offset;
+    requirement.length = requirement_length;
+    requirement.offset = 12;
+
+    printf("=> ");
+
+    if (requirement_print_expression(&requirement, 0) != 0)
+    {
+      printf(" (truncated)");
+    }
+
+    printf("\n");
+  }
+
+  printf("\n");
+}
+
+static void print_entitlements(const uint8_t *blob, uint32_t length)
+{
+  printf(" -- Entitlements --\n");
+
+  if (length > 8) { fwrite(blob + 8, 1, length - 8, stdout); }
+
+  printf("\n\n");
+}
+
+static void verify_batch(void *context, int batch)
+{
+  VerifyJob *job = (VerifyJob *)context;
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  uint8_t *buffer;
+  uint32_t first, last, page;
+  uint64_t start, end, done = 0;
+
+  // Pages that can't be read stay PAGE_READ_ERROR.
+  buffer = malloc((uint64_t)job->page_size * job->batch_pages);
+
+  if (buffer == NULL) { return; }
+
+  first = (uint32_t)batch * job->batch_pages;
+  last = first + job->batch_pages;
+  if (last > job->page_count) { last = job->page_count; }
+
+  start = (uint64_t)first * job->page_size;
+  end = (uint64_t)last * job->page_size;
+
+  if (end > job->code_limit) { end = job->code_limit; }
+
+  while (start + done < end)
+  {
+    ssize_t count = pread(job->fd, buffer + done, end - start - done, start + done);
+    if (count <= 0) { break; }
+    done += count;
+  }
+
+  for (page = first; page < last; page++)
+  {
+    uint64_t offset = (uint64_t)(page - first) * job->page_size;
+    uint64_t length = job->page_size;
+
+    if (start + offset + length > end) { length = end - start - offset; }
+
+    if (offset + length > done)
+    {
+      job->page_status[page] = PAGE_READ_ERROR;
+      continue;
+    }
+
+    hash_page(job->hash_type, digest, buffer + offset, length);
+
+    if (memcmp(digest, job->hashes + ((uint64_t)page * job->hash_size), job->hash_size) != 0)
+    {
+      job->page_status[page] = PAGE_MISMATCH;
+    }
+      else
+    {
+      job->page_status[page] = PAGE_OK;
+    }
+  }
+
+  free(buffer);
+}
+
+int code_signature_verify_pages(
+  CodeDirectory *code_directory,
+  const uint8_t *blob,
+  FILE *fp)
+{
+  VerifyJob job;
+  uint32_t n, bad = 0;
+  int thread_count;
+
+  memset(&job, 0, sizeof(job));
+
+  job.fd = fileno(fp);
+  job.hashes = blob + code_directory->hash_offset;
+  job.code_limit = get_code_limit(code_directory);
+  job.hash_type = code_directory->hash_type;
+  job.hash_size = code_directory->hash_size;
+
+  // A page_size of 0 means the whole code limit is one page.
+  if (code_directory->page_size == 0)
+  {
+    job.page_size = job.code_limit;
+  }
+    else
+  if (code_directory->page_size < 32)
+  {
+    job.page_size = 1 << code_directory->page_size;
+  }
+
+  if (job.page_size == 0) { return -1; }
+
+  job.page_count = (job.code_limit + job.page_size - 1) / job.page_size;
+
+  if (job.page_count != code_directory->code_slot_count)
+  {
+    printf("  warning: code_limit covers %d pages but there are %d code slots\n",
+      job.page_count, code_directory->code_slot_count);
+
+    if (job.page_count > code_directory->code_slot_count)
+    {
+      job.page_count = code_directory->code_slot_count;
+    }
+  }
+
+  if (job.hash_size > SHA256_DIGEST_SIZE ||
+      !is_hash_type_supported(job.hash_type))
+  {
+    printf("  verify: hash type %d (%s) is not supported\n\n",
+      job.hash_type, get_hash_type(job.hash_type));
+    return -1;
+  }
+
+  job.batch_pages = VERIFY_BATCH_BYTES / job.page_size;
+  if (job.batch_pages == 0) { job.batch_pages = 1; }
+
+  // Every page starts as unread so a page no thread got to is reported.
+  job.page_status = malloc(job.page_count == 0 ? 1 : job.page_count);
+  if (job.page_status == NULL) { return -1; }
+
+  memset(job.page_status, PAGE_READ_ERROR, job.page_count);
+
+  thread_count = parallel_run(
+    (job.page_count + job.batch_pages - 1) / job.batch_pages,
+    verify_batch,
+    &job);
+
+  for (n = 0; n < job.page_count; n++)
+  {
+    if (job.page_status[n] == PAGE_OK) { continue; }
+
+    printf("  page %d (0x%lx-0x%lx): %s\n",
+      n,
+      (uint64_t)n * job.page_size,
+      (uint64_t)(n + 1) * job.page_size - 1,
+      job.page_status[n] == PAGE_MISMATCH ? "hash mismatch" : "read error");
+
+    bad++;
+  }
+
+  printf("  verify: %d pages, %d bad (%d threads)\n",
+    job.page_count, bad, thread_count);
+
+  free(job.page_status);
+
+  return bad == 0 ? 0 : -1;
+}
+
+static void verify_special_slots(
+  CodeDirectory *code_directory,
+  const uint8_t *cd_blob,
+  const uint8_t *signature,
+  uint32_t length)
+{
+  const uint8_t *hashes = cd_blob + code_directory->hash_offset;
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  uint32_t count = get_uint32_be(signature + 8);
+  uint32_t slot, n;
+
+  if (code_directory->hash_size > SHA256_DIGEST_SIZE ||
+      !is_hash_type_supported(code_directory->hash_type))
+  {
+    return;
+  }
+
+  for (slot = 1; slot <= code_directory->special_slot_count; slot++)
+  {
+    const uint8_t *expected = hashes - (slot * code_directory->hash_size);
+    const uint8_t *blob = NULL;
+    uint32_t blob_length = 0;
+
+    for (n = 0; n < count && 12 + (n * 8) + 8 <= length; n++)
+    {
+      uint32_t offset = get_uint32_be(signature + 12 + (n * 8) + 4);
+
+      if (get_uint32_be(signature + 12 + (n * 8)) != slot) { continue; }
+      if (offset > length - 8) { break; }
+
+      blob = signature + offset;
+      blob_length = get_uint32_be(blob + 4);
+
+      if (blob_length > length - offset) { blob = NULL; }
+      break;
+    }
+
+    if (blob == NULL)
+    {
+      // Slots like the Info.plist refer to files outside the binary.
+      if (!is_zero(expected, code_directory->hash_size))
+      {
+        printf("  special slot %d: not in binary (not checked)\n", -slot);
+      }
+
+      continue;
+    }
+
+    if (hash_page(code_directory->hash_type, digest, blob, blob_length) != 0)
+    {
+      return;
+    }
+
+    printf("  special slot %d: %s\n",
+      -slot,
+      memcmp(digest, expected, code_directory->hash_size) == 0 ?
+        "ok" : "hash mismatch");
+  }
+}
+
+int code_signature_print(
+  MachoLinkeditData *macho_linkedit_data,
+  FILE *fp,
+  int verify)
+{
+  CodeDirectory code_directory;
+  uint8_t *signature;
+  uint32_t length = macho_linkedit_data->data_size;
+  uint32_t count, n;
+  long marker;
+
+  printf(" -- Code Signature --\n");
+
+  signature = malloc(length == 0 ? 1 : length);
+  if (signature == NULL) { return -1; }
+
+  marker = ftell(fp);
+  fseek(fp, macho_linkedit_data->data_offset, SEEK_SET);
+
+  if (fread(signature, 1, length, fp) != length || length < 12)
+  {
+    printf("Error: Couldn't read code signature.\n\n");
+    fseek(fp, marker, SEEK_SET);
+    free(signature);
+    return -1;
+  }
+
+  fseek(fp, marker, SEEK_SET);
+
+  if (get_uint32_be(signature) != CSMAGIC_EMBEDDED_SIGNATURE)
+  {
+    printf("Error: Unknown code signature magic 0x%08x.\n\n",
+      get_uint32_be(signature));
+    free(signature);
+    return -1;
+  }
+
+  count = get_uint32_be(signature + 8);
+
+  printf("  magic: 0x%08x\n", get_uint32_be(signature));
+  printf(" length: %d\n", get_uint32_be(signature + 4));
+  printf("  count: %d\n", count);
+
+  for (n = 0; n < count && 12 + (n * 8) + 8 <= length; n++)
+  {
+    printf("    %d) type=0x%04x offset=%d\n",
+      n,
+      get_uint32_be(signature + 12 + (n * 8)),
+      get_uint32_be(signature + 12 + (n * 8) + 4));
+  }
+
+  printf("\n");
+
+  for (n = 0; n < count && 12 + (n * 8) + 8 <= length; n++)
+  {
+    uint32_t offset = get_uint32_be(signature + 12 + (n * 8) + 4);
+
+    if (offset > length - 8)
+    {
+      printf("Error: Blob %d is outside the code signature.\n\n", n);
+      continue;
+    }
+
+    const uint8_t *blob = signature + offset;
+    uint32_t magic = get_uint32_be(blob);
+    uint32_t blob_length = get_uint32_be(blob + 4);
+
+    if (blob_length > length - offset) { blob_length = length - offset; }
+
+    switch (magic)
+    {
+      case CSMAGIC_CODEDIRECTORY:
+        if (read_code_directory(&code_directory, blob, blob_length) != 0)
+        {
+          printf("Error: Code directory is truncated.\n\n");
+          break;
+        }
+
+        print_code_directory(&code_directory, blob);
+
+        if (verify)
+        {
+          verify_special_slots(&code_directory, blob, signature, length);
+          code_signature_verify_pages(&code_directory, blob, fp);
+          printf("\n");
+        }
+        break;
+      case CSMAGIC_REQUIREMENTS:
+        print_requirements(blob, blob_length);
+        break;
+      case CSMAGIC_EMBEDDED_ENTITLEMENTS:
+        print_entitlements(blob, blob_length);
+        break;
+      case CSMAGIC_EMBEDDED_DER_ENTITLEMENTS:
+        printf(" -- DER Entitlements --\n");
+        printf("  length: %d\n\n", blob_length);
+        break;
+      case CSMAGIC_BLOBWRAPPER:
+        printf(" -- CMS Signature --\n");
+        printf("  length: %d\n\n", blob_length);
+        break;
+      default:
+        printf(" -- Unknown Blob 0x%08x --\n", magic);
+        printf("  length: %d\n\n", blob_length);
+        break;
+    }
+  }
+
+  free(signature);
+
+  return 0;
+}
+
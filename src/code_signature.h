@@ -0,0 +1,69 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef CODE_SIGNATURE_H
+#define CODE_SIGNATURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "macho.h"
+
+// Code signature blobs are stored big endian, unlike the rest of the file.
+#define CSMAGIC_REQUIREMENT            0xfade0c00
+#define CSMAGIC_REQUIREMENTS           0xfade0c01
+#define CSMAGIC_CODEDIRECTORY          0xfade0c02
+#define CSMAGIC_EMBEDDED_SIGNATURE     0xfade0cc0
+#define CSMAGIC_EMBEDDED_ENTITLEMENTS  0xfade7171
+#define CSMAGIC_EMBEDDED_DER_ENTITLEMENTS 0xfade7172
+#define CSMAGIC_BLOBWRAPPER            0xfade0b01
+
+#define CS_HASHTYPE_SHA1             1
+#define CS_HASHTYPE_SHA256           2
+#define CS_HASHTYPE_SHA256_TRUNCATED 3
+#define CS_HASHTYPE_SHA384           4
+
+typedef struct CodeDirectory
+{
+  uint32_t magic;
+  uint32_t length;
+  uint32_t version;
+  uint32_t flags;
+  uint32_t hash_offset;
+  uint32_t ident_offset;
+  uint32_t special_slot_count;
+  uint32_t code_slot_count;
+  uint32_t code_limit;
+  uint8_t hash_size;
+  uint8_t hash_type;
+  uint8_t platform;
+  uint8_t page_size;
+  uint32_t spare2;
+  uint32_t scatter_offset;
+  uint32_t team_offset;
+  uint32_t spare3;
+  uint64_t code_limit_64;
+  uint64_t exec_seg_base;
+  uint64_t exec_seg_limit;
+  uint64_t exec_seg_flags;
+} CodeDirectory;
+
+int code_signature_print(
+  MachoLinkeditData *macho_linkedit_data,
+  FILE *fp,
+  int verify);
+
+int code_signature_verify_pages(
+  CodeDirectory *code_directory,
+  const uint8_t *blob,
+  FILE *fp);
+
+#endif
+
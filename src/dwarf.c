@@ -0,0 +1,1331 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dwarf.h"
+#include "fileio.h"
+
+// Only this much of a compilation unit is read to decode its first DIE.
+// If the DIE doesn't fit, the whole unit is read instead.
+#define DWARF_DIE_WINDOW 4096
+
+// Unit length, version, abbrev offset and address size of a 32 bit unit.
+#define DWARF_UNIT_HEADER_MIN 11
+
+#define DW_AT_name              0x03
+#define DW_AT_stmt_list         0x10
+#define DW_AT_low_pc            0x11
+#define DW_AT_high_pc           0x12
+#define DW_AT_comp_dir          0x1b
+#define DW_AT_str_offsets_base  0x72
+#define DW_AT_addr_base         0x73
+
+#define DW_FORM_implicit_const  0x21
+
+#define DW_LNCT_path            0x01
+#define DW_LNCT_directory_index 0x02
+
+typedef struct DwarfReader
+{
+  const uint8_t *data;
+  uint64_t length;
+  uint64_t offset;
+  int error;
+} DwarfReader;
+
+typedef struct DwarfAttribute
+{
+  uint32_t form;
+  uint64_t value;
+  const char *string;
+} DwarfAttribute;
+
+typedef struct DwarfSequence
+{
+  int start;
+  int count;
+} DwarfSequence;
+
+static void reader_init(DwarfReader *reader, const uint8_t *data, uint64_t length)
+{
+  reader->data = data;
+  reader->length = length;
+  reader->offset = 0;
+  reader->error = 0;
+}
+
+static int reader_check(DwarfReader *reader, uint64_t size)
+{
+  if (reader->error || size > reader->length - reader->offset)
+  {
+    reader->error = 1;
+    return -1;
+  }
+
+  return 0;
+}
+
+static uint64_t reader_get(DwarfReader *reader, int size)
+{
+  uint64_t value = 0;
+  int n;
+
+  if (size > 8) { reader->error = 1; }
+  if (reader_check(reader, size) != 0) { return 0; }
+
+  for (n = 0; n < size; n++)
+  {
+    value |= (uint64_t)reader->data[reader->offset + n] << (n * 8);
+  }
+
+  reader->offset += size;
+
+  return value;
+}
+
+static uint64_t reader_uleb128(DwarfReader *reader)
+{
+  uint64_t value = 0;
+  int shift = 0;
+
+  while (reader_check(reader, 1) == 0)
+  {
+    uint8_t byte = reader->data[reader->offset++];
+
+    if (shift < 64) { value |= (uint64_t)(byte & 0x7f) << shift; }
+    shift += 7;
+
+    if ((byte & 0x80) == 0) { break; }
+  }
+
+  return value;
+}
+
+static int64_t reader_sleb128(DwarfReader *reader)
+{
+  int64_t value = 0;
+  int shift = 0;
+  uint8_t byte = 0;
+
+  while (reader_check(reader, 1) == 0)
+  {
+    byte = reader->data[reader->offset++];
+
+    if (shift < 64) { value |= (int64_t)(byte & 0x7f) << shift; }
+    shift += 7;
+
+    if ((byte & 0x80) == 0) { break; }
+  }
+
+  if (shift < 64 && (byte & 0x40) != 0) { value |= -((int64_t)1 << shift); }
+
+  return value;
+}
+
+static const char *reader_string(DwarfReader *reader)
+{
+  const char *string = (const char *)reader->data + reader->offset;
+
+  while (reader_check(reader, 1) == 0)
+  {
+    if (reader->data[reader->offset++] == 0) { return string; }
+  }
+
+  return NULL;
+}
+
+static void reader_skip(DwarfReader *reader, uint64_t size)
+{
+  if (reader_check(reader, size) == 0) { reader->offset += size; }
+}
+
+// Reads an initial length field and returns the offset size (4 or 8).
+static int reader_unit_length(DwarfReader *reader, uint64_t *length)
+{
+  *length = reader_get(reader, 4);
+
+  if (*length == 0xffffffff)
+  {
+    *length = reader_get(reader, 8);
+    return 8;
+  }
+
+  return 4;
+}
+
+static int section_is(MachoSection *macho_section, const char *name)
+{
+  return strncmp(macho_section->section_name, name, 16) == 0;
+}
+
+static uint8_t *read_bytes(FILE *fp, uint64_t offset, uint64_t length)
+{
+  uint8_t *data = malloc(length == 0 ? 1 : length);
+
+  if (data == NULL) { return NULL; }
+
+  fseek(fp, offset, SEEK_SET);
+
+  if (fread(data, 1, length, fp) != length)
+  {
+    free(data);
+    return NULL;
+  }
+
+  return data;
+}
+
+static char *read_string(FILE *fp, DwarfSection *section, uint64_t offset)
+{
+  char buffer[4096];
+  int n;
+
+  if (offset >= section->size) { return NULL; }
+
+  fseek(fp, section->offset + offset, SEEK_SET);
+
+  for (n = 0; n < sizeof(buffer) - 1; n++)
+  {
+    int ch = getc(fp);
+    if (ch == 0 || ch == EOF) { break; }
+    buffer[n] = ch;
+  }
+
+  buffer[n] = 0;
+
+  return strdup(buffer);
+}
+
+static uint64_t read_value(FILE *fp, DwarfSection *section, uint64_t offset, int size)
+{
+  if (offset + size > section->size) { return 0; }
+
+  fseek(fp, section->offset + offset, SEEK_SET);
+
+  switch (size)
+  {
+    case 4: return (uint32_t)read_uint32(fp);
+    case 8: return read_uint64(fp);
+    default: return 0;
+  }
+}
+
+// Returns the size of the unit at offset including its length field, or
+// 0 when the length doesn't fit in the section.
+static uint64_t read_unit_size(FILE *fp, DwarfSection *section, uint64_t offset)
+{
+  uint64_t length = read_value(fp, section, offset, 4);
+  int header = 4;
+
+  if (length == 0xffffffff)
+  {
+    length = read_value(fp, section, offset + 4, 8);
+    header = 12;
+  }
+
+  if (offset + header > section->size ||
+      length > section->size - offset - header)
+  {
+    return 0;
+  }
+
+  return length + header;
+}
+
+static int read_form(
+  DwarfReader *reader,
+  DwarfAttribute *attribute,
+  int version,
+  int address_size,
+  int offset_size)
+{
+  attribute->value = 0;
+  attribute->string = NULL;
+
+  switch (attribute->form)
+  {
+    case 0x01: attribute->value = reader_get(reader, address_size); break;
+    case 0x03: reader_skip(reader, reader_get(reader, 2)); break;
+    case 0x04: reader_skip(reader, reader_get(reader, 4)); break;
+    case 0x05: attribute->value = reader_get(reader, 2); break;
+    case 0x06: attribute->value = reader_get(reader, 4); break;
+    case 0x07: attribute->value = reader_get(reader, 8); break;
+    case 0x08: attribute->string = reader_string(reader); break;
+    case 0x09:
+    case 0x18: reader_skip(reader, reader_uleb128(reader)); break;
+    case 0x0a: reader_skip(reader, reader_get(reader, 1)); break;
+    case 0x0b:
+    case 0x0c:
+    case 0x11: attribute->value = reader_get(reader, 1); break;
+    case 0x0d: attribute->value = reader_sleb128(reader); break;
+    case 0x0e:
+    case 0x17:
+    case 0x1d:
+    case 0x1f: attribute->value = reader_get(reader, offset_size); break;
+    case 0x0f:
+    case 0x15:
+    case 0x1a:
+    case 0x1b:
+    case 0x22:
+    case 0x23: attribute->value = reader_uleb128(reader); break;
+    case 0x10:
+      attribute->value =
+        reader_get(reader, version == 2 ? address_size : offset_size);
+      break;
+    case 0x12: attribute->value = reader_get(reader, 2); break;
+    case 0x13:
+    case 0x1c: attribute->value = reader_get(reader, 4); break;
+    case 0x14:
+    case 0x20:
+    case 0x24: attribute->value = reader_get(reader, 8); break;
+    case 0x16:
+      attribute->form = reader_uleb128(reader);
+      if (attribute->form == 0x16) { return -1; }
+      return read_form(reader, attribute, version, address_size, offset_size);
+    case 0x19: attribute->value = 1; break;
+    case 0x1e: reader_skip(reader, 16); break;
+    case DW_FORM_implicit_const: break;
+    case 0x25:
+    case 0x26:
+    case 0x27:
+    case 0x28:
+      attribute->value = reader_get(reader, attribute->form - 0x24);
+      break;
+    case 0x29:
+    case 0x2a:
+    case 0x2b:
+    case 0x2c:
+      attribute->value = reader_get(reader, attribute->form - 0x28);
+      break;
+    default:
+      return -1;
+  }
+
+  return reader->error ? -1 : 0;
+}
+
+static int is_strx_form(int form)
+{
+  return form == 0x1a || (form >= 0x25 && form <= 0x28);
+}
+
+static int is_addrx_form(int form)
+{
+  return form == 0x1b || (form >= 0x29 && form <= 0x2c);
+}
+
+static int is_constant_form(int form)
+{
+  switch (form)
+  {
+    case 0x05:
+    case 0x06:
+    case 0x07:
+    case 0x0b:
+    case 0x0d:
+    case 0x0f:
+    case DW_FORM_implicit_const:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static char *get_attribute_string(
+  Dwarf *dwarf,
+  FILE *fp,
+  DwarfAttribute *attribute,
+  uint64_t str_offsets_base,
+  int offset_size)
+{
+  switch (attribute->form)
+  {
+    case 0x08:
+      return attribute->string == NULL ? NULL : strdup(attribute->string);
+    case 0x0e:
+      return read_string(fp, &dwarf->str, attribute->value);
+    case 0x1f:
+      return read_string(fp, &dwarf->line_str, attribute->value);
+    default:
+      break;
+  }
+
+  if (is_strx_form(attribute->form))
+  {
+    uint64_t offset = read_value(
+      fp,
+      &dwarf->str_offsets,
+      str_offsets_base + (attribute->value * offset_size),
+      offset_size);
+
+    return read_string(fp, &dwarf->str, offset);
+  }
+
+  return NULL;
+}
+
+static int find_abbrev(
+  Dwarf *dwarf,
+  FILE *fp,
+  DwarfReader *reader,
+  uint64_t abbrev_offset,
+  uint64_t code)
+{
+  if (dwarf->abbrev_data == NULL)
+  {
+    dwarf->abbrev_data = read_bytes(fp, dwarf->abbrev.offset, dwarf->abbrev.size);
+    if (dwarf->abbrev_data == NULL) { return -1; }
+  }
+
+  reader_init(reader, dwarf->abbrev_data, dwarf->abbrev.size);
+  reader_skip(reader, abbrev_offset);
+
+  while (!reader->error)
+  {
+    uint64_t entry_code = reader_uleb128(reader);
+
+    if (entry_code == 0) { return -1; }
+
+    // Tag and the has_children byte.
+    reader_uleb128(reader);
+    reader_get(reader, 1);
+
+    if (entry_code == code) { return reader->error ? -1 : 0; }
+
+    while (!reader->error)
+    {
+      uint64_t name = reader_uleb128(reader);
+      uint64_t form = reader_uleb128(reader);
+
+      if (form == DW_FORM_implicit_const) { reader_sleb128(reader); }
+      if (name == 0 && form == 0) { break; }
+    }
+  }
+
+  return -1;
+}
+
+static int parse_unit_die(
+  Dwarf *dwarf,
+  FILE *fp,
+  DwarfUnit *unit,
+  const uint8_t *data,
+  uint64_t length)
+{
+  DwarfReader reader, abbrev;
+  DwarfAttribute name, comp_dir, low_pc, high_pc, attribute;
+  uint64_t unit_length, abbrev_offset;
+  uint64_t str_offsets_base = 0, addr_base = 0;
+  int offset_size, version, address_size, unit_type = 1;
+
+  memset(&name, 0, sizeof(name));
+  memset(&comp_dir, 0, sizeof(comp_dir));
+  memset(&low_pc, 0, sizeof(low_pc));
+  memset(&high_pc, 0, sizeof(high_pc));
+
+  reader_init(&reader, data, length);
+
+  offset_size = reader_unit_length(&reader, &unit_length);
+  version = reader_get(&reader, 2);
+
+  if (version >= 5)
+  {
+    unit_type = reader_get(&reader, 1);
+    address_size = reader_get(&reader, 1);
+    abbrev_offset = reader_get(&reader, offset_size);
+
+    // Skeleton and split units have a dwo_id, type units a signature
+    // and type offset.
+    if (unit_type == 4 || unit_type == 5) { reader_skip(&reader, 8); }
+    if (unit_type == 2 || unit_type == 6) { reader_skip(&reader, 8 + offset_size); }
+  }
+    else
+  {
+    abbrev_offset = reader_get(&reader, offset_size);
+    address_size = reader_get(&reader, 1);
+  }
+
+  if (reader.error) { return -1; }
+
+  if (version < 2 || version > 5 || (address_size != 4 && address_size != 8))
+  {
+    return 0;
+  }
+
+  if (find_abbrev(dwarf, fp, &abbrev, abbrev_offset, reader_uleb128(&reader)) != 0)
+  {
+    return reader.error ? -1 : 0;
+  }
+
+  while (1)
+  {
+    uint64_t at = reader_uleb128(&abbrev);
+    attribute.form = reader_uleb128(&abbrev);
+
+    if (abbrev.error) { return 0; }
+    if (at == 0 && attribute.form == 0) { break; }
+
+    int64_t implicit = 0;
+
+    if (attribute.form == DW_FORM_implicit_const)
+    {
+      implicit = reader_sleb128(&abbrev);
+    }
+
+    // Only running out of bytes is worth a retry with a larger window.
+    if (read_form(&reader, &attribute, version, address_size, offset_size) != 0)
+    {
+      return reader.error ? -1 : 0;
+    }
+
+    if (attribute.form == DW_FORM_implicit_const) { attribute.value = implicit; }
+
+    switch (at)
+    {
+      case DW_AT_name: name = attribute; break;
+      case DW_AT_comp_dir: comp_dir = attribute; break;
+      case DW_AT_low_pc: low_pc = attribute; break;
+      case DW_AT_high_pc: high_pc = attribute; break;
+      case DW_AT_str_offsets_base: str_offsets_base = attribute.value; break;
+      case DW_AT_addr_base: addr_base = attribute.value; break;
+      case DW_AT_stmt_list:
+        unit->stmt_list = attribute.value;
+        unit->has_stmt_list = 1;
+        break;
+      default:
+        break;
+    }
+  }
+
+  unit->name = get_attribute_string(dwarf, fp, &name, str_offsets_base, offset_size);
+  unit->comp_dir = get_attribute_string(dwarf, fp, &comp_dir, str_offsets_base, offset_size);
+
+  if (low_pc.form != 0 && high_pc.form != 0)
+  {
+    if (is_addrx_form(low_pc.form))
+    {
+      low_pc.value = read_value(
+        fp,
+        &dwarf->addr,
+        addr_base + (low_pc.value * address_size),
+        address_size);
+    }
+
+    unit->low_pc = low_pc.value;
+
+    if (is_constant_form(high_pc.form))
+    {
+      unit->high_pc = low_pc.value + high_pc.value;
+    }
+      else
+    if (is_addrx_form(high_pc.form))
+    {
+      unit->high_pc = read_value(
+        fp,
+        &dwarf->addr,
+        addr_base + (high_pc.value * address_size),
+        address_size);
+    }
+      else
+    {
+      unit->high_pc = high_pc.value;
+    }
+
+    unit->has_range = unit->high_pc > unit->low_pc;
+  }
+
+  return 0;
+}
+
+static void decode_unit_die(Dwarf *dwarf, FILE *fp, DwarfUnit *unit)
+{
+  uint64_t remain, length;
+  uint8_t *data;
+
+  if (unit->die_decoded) { return; }
+  unit->die_decoded = 1;
+
+  if (unit->offset >= dwarf->info.size) { return; }
+
+  // Units found through __debug_aranges haven't had their length read.
+  if (unit->length == 0)
+  {
+    unit->length = read_unit_size(fp, &dwarf->info, unit->offset);
+  }
+
+  if (unit->length < DWARF_UNIT_HEADER_MIN) { return; }
+
+  remain = dwarf->info.size - unit->offset;
+  if (unit->length < remain) { remain = unit->length; }
+
+  length = remain < DWARF_DIE_WINDOW ? remain : DWARF_DIE_WINDOW;
+
+  while (1)
+  {
+    data = read_bytes(fp, dwarf->info.offset + unit->offset, length);
+    if (data == NULL) { return; }
+
+    int error = parse_unit_die(dwarf, fp, unit, data, length);
+
+    free(data);
+
+    if (error == 0 || length == remain) { return; }
+
+    length = remain;
+  }
+}
+
+static char *join_path(const char *directory, const char *name)
+{
+  char *path;
+
+  if (name == NULL) { return strdup("??"); }
+
+  if (name[0] == '/' || directory == NULL || directory[0] == 0)
+  {
+    return strdup(name);
+  }
+
+  path = malloc(strlen(directory) + strlen(name) + 2);
+  if (path == NULL) { return NULL; }
+
+  sprintf(path, "%s%s%s",
+    directory,
+    directory[strlen(directory) - 1] == '/' ? "" : "/",
+    name);
+
+  return path;
+}
+
+static void add_file(DwarfUnit *unit, char *path)
+{
+  char **files = realloc(unit->files, (unit->file_count + 1) * sizeof(char *));
+
+  if (files == NULL) { free(path); return; }
+
+  unit->files = files;
+  unit->files[unit->file_count++] = path;
+}
+
+static char *directory_path(DwarfUnit *unit, const char *directory)
+{
+  if (directory == NULL) { return NULL; }
+  if (directory[0] == '/' || unit->comp_dir == NULL) { return strdup(directory); }
+
+  return join_path(unit->comp_dir, directory);
+}
+
+static int read_v5_entries(
+  Dwarf *dwarf,
+  FILE *fp,
+  DwarfUnit *unit,
+  DwarfReader *reader,
+  int offset_size,
+  char ***directories,
+  int *directory_count,
+  int is_files)
+{
+  uint64_t formats[32];
+  DwarfAttribute attribute;
+  int format_count, count, n, i;
+
+  format_count = reader_get(reader, 1);
+  if (format_count > 16) { return -1; }
+
+  for (n = 0; n < format_count; n++)
+  {
+    formats[n * 2] = reader_uleb128(reader);
+    formats[n * 2 + 1] = reader_uleb128(reader);
+  }
+
+  count = reader_uleb128(reader);
+  if (reader->error) { return -1; }
+
+  for (n = 0; n < count && !reader->error; n++)
+  {
+    char *name = NULL;
+    uint64_t directory = 0;
+
+    for (i = 0; i < format_count; i++)
+    {
+      attribute.form = formats[i * 2 + 1];
+
+      if (read_form(reader, &attribute, 5, 8, offset_size) != 0)
+      {
+        free(name);
+        return -1;
+      }
+
+      if (formats[i * 2] == DW_LNCT_path)
+      {
+        free(name);
+        name = get_attribute_string(dwarf, fp, &attribute, 0, offset_size);
+      }
+        else
+      if (formats[i * 2] == DW_LNCT_directory_index)
+      {
+        directory = attribute.value;
+      }
+    }
+
+    if (is_files)
+    {
+      const char *base = directory < *directory_count ?
+        (*directories)[directory] : NULL;
+
+      add_file(unit, join_path(base, name));
+      free(name);
+    }
+      else
+    {
+      char **list = realloc(*directories, (*directory_count + 1) * sizeof(char *));
+      if (list == NULL) { free(name); return -1; }
+
+      *directories = list;
+      (*directories)[(*directory_count)++] = directory_path(unit, name);
+      free(name);
+    }
+  }
+
+  return reader->error ? -1 : 0;
+}
+
+static int add_row(
+  DwarfLine **rows,
+  int *count,
+  int *allocated,
+  uint64_t address,
+  uint32_t file,
+  uint32_t line)
+{
+  if (*count == *allocated)
+  {
+    int size = *allocated == 0 ? 256 : *allocated * 2;
+    DwarfLine *list = realloc(*rows, size * sizeof(DwarfLine));
+
+    if (list == NULL) { return -1; }
+
+    *rows = list;
+    *allocated = size;
+  }
+
+  (*rows)[*count].address = address;
+  (*rows)[*count].file = file;
+  (*rows)[*count].line = line;
+  (*count)++;
+
+  return 0;
+}
+
+static const DwarfLine *sort_rows;
+
+static int compare_sequences(const void *a, const void *b)
+{
+  uint64_t address_a = sort_rows[((const DwarfSequence *)a)->start].address;
+  uint64_t address_b = sort_rows[((const DwarfSequence *)b)->start].address;
+
+  if (address_a < address_b) { return -1; }
+  if (address_a > address_b) { return 1; }
+
+  return ((const DwarfSequence *)a)->start - ((const DwarfSequence *)b)->start;
+}
+
+// Addresses only increase inside a sequence, so the table is put in
+// address order by sorting whole sequences rather than individual rows.
+static void sort_sequences(
+  DwarfUnit *unit,
+  DwarfLine *rows,
+  DwarfSequence *sequences,
+  int sequence_count)
+{
+  int n, count = 0;
+
+  for (n = 0; n < sequence_count; n++) { count += sequences[n].count; }
+
+  unit->lines = malloc((count == 0 ? 1 : count) * sizeof(DwarfLine));
+  if (unit->lines == NULL) { return; }
+
+  if (sequence_count > 1)
+  {
+    sort_rows = rows;
+    qsort(sequences, sequence_count, sizeof(DwarfSequence), compare_sequences);
+  }
+
+  for (n = 0; n < sequence_count; n++)
+  {
+    memcpy(unit->lines + unit->line_count,
+      rows + sequences[n].start,
+      sequences[n].count * sizeof(DwarfLine));
+
+    unit->line_count += sequences[n].count;
+  }
+}
+
+static void parse_line_program(
+  Dwarf *dwarf,
+  FILE *fp,
+  DwarfUnit *unit,
+  const uint8_t *data,
+  uint64_t length)
+{
+  DwarfReader reader;
+  DwarfLine *rows = NULL;
+  DwarfSequence *sequences = NULL;
+  char **directories = NULL;
+  uint8_t standard_lengths[256];
+  uint64_t unit_length, header_length, program;
+  int row_count = 0, rows_allocated = 0;
+  int sequence_count = 0, sequence_start = 0;
+  int directory_count = 0;
+  int offset_size, version, n;
+
+  reader_init(&reader, data, length);
+
+  offset_size = reader_unit_length(&reader, &unit_length);
+  version = reader_get(&reader, 2);
+
+  if (version < 2 || version > 5) { return; }
+
+  if (version >= 5) { reader_skip(&reader, 2); }
+
+  header_length = reader_get(&reader, offset_size);
+  program = reader.offset + header_length;
+
+  int min_inst_length = reader_get(&reader, 1);
+  if (version >= 4) { reader_get(&reader, 1); }
+  int default_is_stmt = reader_get(&reader, 1);
+  int line_base = (int8_t)reader_get(&reader, 1);
+  int line_range = reader_get(&reader, 1);
+  int opcode_base = reader_get(&reader, 1);
+
+  (void)default_is_stmt;
+
+  if (reader.error || line_range == 0 || opcode_base == 0) { return; }
+
+  memset(standard_lengths, 0, sizeof(standard_lengths));
+
+  for (n = 1; n < opcode_base; n++)
+  {
+    standard_lengths[n] = reader_get(&reader, 1);
+  }
+
+  if (version >= 5)
+  {
+    if (read_v5_entries(dwarf, fp, unit, &reader, offset_size,
+          &directories, &directory_count, 0) != 0 ||
+        read_v5_entries(dwarf, fp, unit, &reader, offset_size,
+          &directories, &directory_count, 1) != 0)
+    {
+      goto cleanup;
+    }
+  }
+    else
+  {
+    const char *name;
+
+    // File numbers start at 1 before DWARF 5, so slot 0 is unused.
+    add_file(unit, strdup("??"));
+
+    while ((name = reader_string(&reader)) != NULL && name[0] != 0)
+    {
+      char **list = realloc(directories, (directory_count + 1) * sizeof(char *));
+      if (list == NULL) { goto cleanup; }
+
+      directories = list;
+      directories[directory_count++] = directory_path(unit, name);
+    }
+
+    while ((name = reader_string(&reader)) != NULL && name[0] != 0)
+    {
+      uint64_t directory = reader_uleb128(&reader);
+
+      reader_uleb128(&reader);
+      reader_uleb128(&reader);
+
+      if (directory == 0)
+      {
+        add_file(unit, join_path(unit->comp_dir, name));
+      }
+        else
+      {
+        add_file(unit, join_path(
+          directory <= directory_count ? directories[directory - 1] : NULL,
+          name));
+      }
+    }
+  }
+
+  if (reader.error) { goto cleanup; }
+
+  reader.offset = program;
+  if (reader.length > 4 + unit_length + (offset_size == 8 ? 8 : 0))
+  {
+    reader.length = 4 + unit_length + (offset_size == 8 ? 8 : 0);
+  }
+
+  uint64_t address = 0;
+  uint32_t file = 1, line = 1;
+
+  while (reader.offset < reader.length && !reader.error)
+  {
+    int opcode = reader_get(&reader, 1);
+    int emit = 0;
+
+    if (opcode >= opcode_base)
+    {
+      int adjusted = opcode - opcode_base;
+
+      address += (adjusted / line_range) * min_inst_length;
+      line += line_base + (adjusted % line_range);
+      emit = 1;
+    }
+      else
+    if (opcode == 0)
+    {
+      uint64_t size = reader_uleb128(&reader);
+      uint64_t end = reader.offset + size;
+
+      if (size == 0 || reader_check(&reader, size) != 0) { break; }
+
+      switch (reader_get(&reader, 1))
+      {
+        case 1:
+          // DW_LNE_end_sequence
+          if (add_row(&rows, &row_count, &rows_allocated,
+                address, file, DWARF_END_SEQUENCE) != 0)
+          {
+            goto cleanup;
+          }
+
+          DwarfSequence *list = realloc(sequences,
+            (sequence_count + 1) * sizeof(DwarfSequence));
+          if (list == NULL) { goto cleanup; }
+
+          sequences = list;
+          sequences[sequence_count].start = sequence_start;
+          sequences[sequence_count].count = row_count - sequence_start;
+          sequence_count++;
+          sequence_start = row_count;
+
+          address = 0;
+          file = 1;
+          line = 1;
+          break;
+        case 2:
+          // DW_LNE_set_address
+          address = reader_get(&reader, size - 1);
+          break;
+        case 3:
+        {
+          // DW_LNE_define_file
+          const char *name = reader_string(&reader);
+          uint64_t directory = reader_uleb128(&reader);
+
+          add_file(unit, join_path(
+            directory == 0 ? unit->comp_dir :
+            directory <= directory_count ? directories[directory - 1] : NULL,
+            name));
+          break;
+        }
+        default:
+          break;
+      }
+
+      reader.offset = end;
+    }
+      else
+    {
+      switch (opcode)
+      {
+        case 1: emit = 1; break;
+        case 2: address += reader_uleb128(&reader) * min_inst_length; break;
+        case 3: line += reader_sleb128(&reader); break;
+        case 4: file = reader_uleb128(&reader); break;
+        case 8: address += ((255 - opcode_base) / line_range) * min_inst_length; break;
+        case 9: address += reader_get(&reader, 2); break;
+        default:
+          for (n = 0; n < standard_lengths[opcode]; n++)
+          {
+            reader_uleb128(&reader);
+          }
+          break;
+      }
+    }
+
+    if (emit)
+    {
+      if (add_row(&rows, &row_count, &rows_allocated, address, file, line) != 0)
+      {
+        goto cleanup;
+      }
+    }
+  }
+
+  sort_sequences(unit, rows, sequences, sequence_count);
+
+cleanup:
+  for (n = 0; n < directory_count; n++) { free(directories[n]); }
+
+  free(directories);
+  free(sequences);
+  free(rows);
+}
+
+static void decode_unit_lines(Dwarf *dwarf, FILE *fp, DwarfUnit *unit)
+{
+  uint64_t length;
+  uint8_t *data;
+
+  if (unit->lines_decoded) { return; }
+
+  decode_unit_die(dwarf, fp, unit);
+  unit->lines_decoded = 1;
+
+  if (!unit->has_stmt_list || unit->stmt_list + 4 > dwarf->line.size) { return; }
+
+  length = read_unit_size(fp, &dwarf->line, unit->stmt_list);
+  if (length == 0) { return; }
+
+  data = read_bytes(fp, dwarf->line.offset + unit->stmt_list, length);
+  if (data == NULL) { return; }
+
+  parse_line_program(dwarf, fp, unit, data, length);
+
+  free(data);
+}
+
+static int add_unit(Dwarf *dwarf, uint64_t offset)
+{
+  DwarfUnit *units = realloc(dwarf->units, (dwarf->unit_count + 1) * sizeof(DwarfUnit));
+
+  if (units == NULL) { return -1; }
+
+  dwarf->units = units;
+  memset(&dwarf->units[dwarf->unit_count], 0, sizeof(DwarfUnit));
+  dwarf->units[dwarf->unit_count].offset = offset;
+
+  return dwarf->unit_count++;
+}
+
+static int add_range(Dwarf *dwarf, uint64_t start, uint64_t end, int unit)
+{
+  DwarfRange *ranges = realloc(dwarf->ranges, (dwarf->range_count + 1) * sizeof(DwarfRange));
+
+  if (ranges == NULL) { return -1; }
+
+  dwarf->ranges = ranges;
+  dwarf->ranges[dwarf->range_count].start = start;
+  dwarf->ranges[dwarf->range_count].end = end;
+  dwarf->ranges[dwarf->range_count].unit = unit;
+  dwarf->range_count++;
+
+  return 0;
+}
+
+static int compare_ranges(const void *a, const void *b)
+{
+  const DwarfRange *range_a = (const DwarfRange *)a;
+  const DwarfRange *range_b = (const DwarfRange *)b;
+
+  if (range_a->start < range_b->start) { return -1; }
+  if (range_a->start > range_b->start) { return 1; }
+
+  return 0;
+}
+
+static void index_aranges(Dwarf *dwarf, FILE *fp)
+{
+  DwarfReader reader;
+  uint8_t *data;
+
+  data = read_bytes(fp, dwarf->aranges.offset, dwarf->aranges.size);
+  if (data == NULL) { return; }
+
+  reader_init(&reader, data, dwarf->aranges.size);
+
+  while (reader.offset < reader.length && !reader.error)
+  {
+    uint64_t start = reader.offset;
+    uint64_t length;
+    int offset_size = reader_unit_length(&reader, &length);
+
+    // Checked before adding so a huge length can't wrap end back to start.
+    if (reader.error || length > reader.length - reader.offset) { break; }
+
+    uint64_t end = reader.offset + length;
+
+    reader_get(&reader, 2);
+    uint64_t info_offset = reader_get(&reader, offset_size);
+    int address_size = reader_get(&reader, 1);
+    int segment_size = reader_get(&reader, 1);
+
+    if (reader.error || end > reader.length) { break; }
+
+    if (address_size == 4 || address_size == 8)
+    {
+      int tuple_size = segment_size + (address_size * 2);
+      int unit = add_unit(dwarf, info_offset);
+
+      // Tuples are aligned to twice the address size from the set start.
+      reader.offset = start +
+        (((reader.offset - start) + (address_size * 2) - 1) /
+         (address_size * 2)) * (address_size * 2);
+
+      while (unit >= 0 && reader.offset + tuple_size <= end)
+      {
+        reader_skip(&reader, segment_size);
+
+        uint64_t address = reader_get(&reader, address_size);
+        uint64_t size = reader_get(&reader, address_size);
+
+        if (address == 0 && size == 0) { break; }
+
+        add_range(dwarf, address, address + size, unit);
+      }
+    }
+
+    reader.offset = end;
+  }
+
+  free(data);
+}
+
+// Without __debug_aranges only the first DIE of each unit is decoded
+// to get its address range.
+static void index_units(Dwarf *dwarf, FILE *fp)
+{
+  uint64_t offset = 0;
+  int n;
+
+  while (offset + 4 <= dwarf->info.size)
+  {
+    uint64_t length = read_unit_size(fp, &dwarf->info, offset);
+
+    // A bad length would otherwise stop the offset from moving forward.
+    if (length < DWARF_UNIT_HEADER_MIN) { break; }
+
+    int unit = add_unit(dwarf, offset);
+
+    if (unit < 0) { break; }
+
+    dwarf->units[unit].length = length;
+
+    offset += length;
+  }
+
+  for (n = 0; n < dwarf->unit_count; n++)
+  {
+    decode_unit_die(dwarf, fp, &dwarf->units[n]);
+
+    if (dwarf->units[n].has_range)
+    {
+      add_range(dwarf, dwarf->units[n].low_pc, dwarf->units[n].high_pc, n);
+    }
+  }
+}
+
+static void check_section(DwarfSection *section, uint64_t file_size)
+{
+  if (section->offset > file_size || section->size > file_size - section->offset)
+  {
+    section->size = 0;
+  }
+}
+
+static void build_index(Dwarf *dwarf, FILE *fp)
+{
+  uint64_t file_size;
+
+  dwarf->indexed = 1;
+
+  // Section headers aren't trusted to stay inside the file.
+  fseek(fp, 0, SEEK_END);
+  file_size = ftell(fp);
+
+  check_section(&dwarf->info, file_size);
+  check_section(&dwarf->abbrev, file_size);
+  check_section(&dwarf->aranges, file_size);
+  check_section(&dwarf->line, file_size);
+  check_section(&dwarf->str, file_size);
+  check_section(&dwarf->line_str, file_size);
+  check_section(&dwarf->str_offsets, file_size);
+  check_section(&dwarf->addr, file_size);
+
+  if (dwarf->aranges.size != 0) { index_aranges(dwarf, fp); }
+
+  if (dwarf->range_count == 0)
+  {
+    int n;
+
+    for (n = 0; n < dwarf->unit_count; n++)
+    {
+      free(dwarf->units[n].name);
+      free(dwarf->units[n].comp_dir);
+    }
+
+    free(dwarf->units);
+    dwarf->units = NULL;
+    dwarf->unit_count = 0;
+
+    index_units(dwarf, fp);
+  }
+
+  if (dwarf->range_count > 1)
+  {
+    qsort(dwarf->ranges, dwarf->range_count, sizeof(DwarfRange), compare_ranges);
+  }
+}
+
+static int lookup_unit(
+  DwarfUnit *unit,
+  uint64_t address,
+  const char **filename,
+  int *line)
+{
+  int low = 0, high = unit->line_count - 1, found = -1;
+
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+
+    if (unit->lines[middle].address <= address)
+    {
+      found = middle;
+      low = middle + 1;
+    }
+      else
+    {
+      high = middle - 1;
+    }
+  }
+
+  if (found < 0 || unit->lines[found].line == DWARF_END_SEQUENCE) { return -1; }
+
+  *line = unit->lines[found].line;
+  *filename = unit->lines[found].file < unit->file_count ?
+    unit->files[unit->lines[found].file] : "??";
+
+  return 0;
+}
+
+void dwarf_init(Dwarf *dwarf)
+{
+  memset(dwarf, 0, sizeof(Dwarf));
+}
+
+void dwarf_free(Dwarf *dwarf)
+{
+  int n, i;
+
+  for (n = 0; n < dwarf->unit_count; n++)
+  {
+    DwarfUnit *unit = &dwarf->units[n];
+
+    for (i = 0; i < unit->file_count; i++) { free(unit->files[i]); }
+
+    free(unit->files);
+    free(unit->lines);
+    free(unit->name);
+    free(unit->comp_dir);
+  }
+
+  free(dwarf->units);
+  free(dwarf->ranges);
+  free(dwarf->abbrev_data);
+
+  memset(dwarf, 0, sizeof(Dwarf));
+}
+
+void dwarf_add_section(Dwarf *dwarf, MachoSection *macho_section)
+{
+  DwarfSection *section = NULL;
+
+  if (strncmp(macho_section->segment_name, "__DWARF", 16) != 0) { return; }
+
+  if (section_is(macho_section, "__debug_info")) { section = &dwarf->info; }
+  else if (section_is(macho_section, "__debug_abbrev")) { section = &dwarf->abbrev; }
+  else if (section_is(macho_section, "__debug_aranges")) { section = &dwarf->aranges; }
+  else if (section_is(macho_section, "__debug_line")) { section = &dwarf->line; }
+  else if (section_is(macho_section, "__debug_str")) { section = &dwarf->str; }
+  else if (section_is(macho_section, "__debug_line_str")) { section = &dwarf->line_str; }
+  else if (section_is(macho_section, "__debug_str_offs")) { section = &dwarf->str_offsets; }
+  else if (section_is(macho_section, "__debug_addr")) { section = &dwarf->addr; }
+
+  if (section == NULL) { return; }
+
+  section->offset = macho_section->offset;
+  section->size = macho_section->size;
+}
+
+int dwarf_lookup(
+  Dwarf *dwarf,
+  FILE *fp,
+  uint64_t address,
+  const char **filename,
+  int *line)
+{
+  long marker = ftell(fp);
+  int low = 0, high, found = -1, n;
+  int result = -1;
+
+  if (!dwarf->indexed) { build_index(dwarf, fp); }
+
+  if (dwarf->info.size == 0 || dwarf->line.size == 0)
+  {
+    fseek(fp, marker, SEEK_SET);
+    return -1;
+  }
+
+  high = dwarf->range_count - 1;
+
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+
+    if (dwarf->ranges[middle].start <= address)
+    {
+      found = middle;
+      low = middle + 1;
+    }
+      else
+    {
+      high = middle - 1;
+    }
+  }
+
+  if (found >= 0 && address < dwarf->ranges[found].end)
+  {
+    DwarfUnit *unit = &dwarf->units[dwarf->ranges[found].unit];
+
+    decode_unit_lines(dwarf, fp, unit);
+    result = lookup_unit(unit, address, filename, line);
+  }
+
+  // Units described with DW_AT_ranges instead of low_pc / high_pc have
+  // no entry in the range table, so their line tables are searched last.
+  for (n = 0; n < dwarf->unit_count && result != 0; n++)
+  {
+    DwarfUnit *unit = &dwarf->units[n];
+
+    if (!unit->die_decoded || unit->has_range) { continue; }
+
+    decode_unit_lines(dwarf, fp, unit);
+    result = lookup_unit(unit, address, filename, line);
+  }
+
+  fseek(fp, marker, SEEK_SET);
+
+  return result;
+}
+
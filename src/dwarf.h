@@ -0,0 +1,91 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef DWARF_H
+#define DWARF_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "macho.h"
+
+typedef struct DwarfSection
+{
+  uint64_t offset;
+  uint64_t size;
+} DwarfSection;
+
+// One row of a decoded line table. Rows are kept sorted by address and
+// a row with line DWARF_END_SEQUENCE marks the end of a sequence.
+typedef struct DwarfLine
+{
+  uint64_t address;
+  uint32_t file;
+  uint32_t line;
+} DwarfLine;
+
+#define DWARF_END_SEQUENCE 0xffffffff
+
+typedef struct DwarfUnit
+{
+  uint64_t offset;
+  uint64_t length;
+  uint64_t low_pc;
+  uint64_t high_pc;
+  uint64_t stmt_list;
+  char *name;
+  char *comp_dir;
+  char **files;
+  int file_count;
+  DwarfLine *lines;
+  int line_count;
+  uint8_t has_range;
+  uint8_t has_stmt_list;
+  uint8_t die_decoded;
+  uint8_t lines_decoded;
+} DwarfUnit;
+
+typedef struct DwarfRange
+{
+  uint64_t start;
+  uint64_t end;
+  int unit;
+} DwarfRange;
+
+typedef struct Dwarf
+{
+  DwarfSection info;
+  DwarfSection abbrev;
+  DwarfSection aranges;
+  DwarfSection line;
+  DwarfSection str;
+  DwarfSection line_str;
+  DwarfSection str_offsets;
+  DwarfSection addr;
+  uint8_t *abbrev_data;
+  DwarfUnit *units;
+  int unit_count;
+  DwarfRange *ranges;
+  int range_count;
+  int indexed;
+} Dwarf;
+
+void dwarf_init(Dwarf *dwarf);
+void dwarf_free(Dwarf *dwarf);
+void dwarf_add_section(Dwarf *dwarf, MachoSection *macho_section);
+int dwarf_lookup(
+  Dwarf *dwarf,
+  FILE *fp,
+  uint64_t address,
+  const char **filename,
+  int *line);
+
+#endif
+
@@ -0,0 +1,174 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "function_starts.h"
+
+#define HIGH_BITS 0x8080808080808080ULL
+#define LOW_BITS  0x0101010101010101ULL
+
+// The list is a series of ULEB128 deltas from the start of __TEXT ending
+// with a 0. Nearly every delta fits in one byte, so eight bytes are
+// checked at once and decoded without branching when none of them has a
+// continuation bit and none is the terminator. The addresses array must
+// have room for length entries, which is the most there can be.
+int function_starts_decode(
+  const uint8_t *data,
+  uint32_t length,
+  uint64_t base,
+  uint64_t *addresses)
+{
+  uint64_t address = base;
+  uint64_t delta, word;
+  uint32_t n = 0;
+  uint8_t byte;
+  int count = 0;
+  int shift;
+
+  while (n < length)
+  {
+    if (n + 8 <= length)
+    {
+      memcpy(&word, data + n, 8);
+
+      if ((word & HIGH_BITS) == 0 &&
+          ((word - LOW_BITS) & ~word & HIGH_BITS) == 0)
+      {
+        addresses[count + 0] = address += data[n + 0];
+        addresses[count + 1] = address += data[n + 1];
+        addresses[count + 2] = address += data[n + 2];
+        addresses[count + 3] = address += data[n + 3];
+        addresses[count + 4] = address += data[n + 4];
+        addresses[count + 5] = address += data[n + 5];
+        addresses[count + 6] = address += data[n + 6];
+        addresses[count + 7] = address += data[n + 7];
+
+        count += 8;
+        n += 8;
+        continue;
+      }
+    }
+
+    delta = 0;
+    shift = 0;
+
+    do
+    {
+      if (n >= length) { return count; }
+
+      byte = data[n++];
+
+      if (shift < 64) { delta |= (uint64_t)(byte & 0x7f) << shift; }
+      shift += 7;
+    } while ((byte & 0x80) != 0);
+
+    if (delta == 0) { break; }
+
+    address += delta;
+    addresses[count++] = address;
+  }
+
+  return count;
+}
+
+int function_starts_read(
+  MachoLinkeditData *macho_linkedit_data,
+  FILE *fp,
+  uint64_t text_address,
+  uint64_t **addresses)
+{
+  uint32_t length = macho_linkedit_data->data_size;
+  uint8_t *data;
+  uint64_t *list;
+  long marker;
+  int count;
+
+  *addresses = NULL;
+
+  data = malloc(length == 0 ? 1 : length);
+  list = malloc((length == 0 ? 1 : length) * sizeof(uint64_t));
+
+  if (data == NULL || list == NULL)
+  {
+    free(data);
+    free(list);
+    return -1;
+  }
+
+  marker = ftell(fp);
+  fseek(fp, macho_linkedit_data->data_offset, SEEK_SET);
+
+  if (fread(data, 1, length, fp) != length)
+  {
+    fseek(fp, marker, SEEK_SET);
+    free(data);
+    free(list);
+    return -1;
+  }
+
+  fseek(fp, marker, SEEK_SET);
+
+  count = function_starts_decode(data, length, text_address, list);
+
+  free(data);
+
+  *addresses = realloc(list, (count == 0 ? 1 : count) * sizeof(uint64_t));
+  if (*addresses == NULL) { *addresses = list; }
+
+  return count;
+}
+
+int function_starts_find(
+  uint64_t *addresses,
+  int count,
+  uint64_t end,
+  uint64_t address)
+{
+  int low = 0, high = count - 1, found = -1;
+
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+
+    if (addresses[middle] <= address)
+    {
+      found = middle;
+      low = middle + 1;
+    }
+      else
+    {
+      high = middle - 1;
+    }
+  }
+
+  if (found == count - 1 && end != 0 && address >= end) { return -1; }
+
+  return found;
+}
+
+void function_starts_print(uint64_t *addresses, int count)
+{
+  int n;
+
+  printf(" -- Function Starts --\n");
+  printf("  count: %d\n", count);
+
+  for (n = 0; n < count; n++)
+  {
+    printf("  %d) 0x%lx\n", n, addresses[n]);
+  }
+
+  printf("\n");
+}
+
@@ -0,0 +1,42 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef FUNCTION_STARTS_H
+#define FUNCTION_STARTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "macho.h"
+
+int function_starts_decode(
+  const uint8_t *data,
+  uint32_t length,
+  uint64_t base,
+  uint64_t *addresses);
+
+int function_starts_read(
+  MachoLinkeditData *macho_linkedit_data,
+  FILE *fp,
+  uint64_t text_address,
+  uint64_t **addresses);
+
+// The last function is taken to stop at end (the end of __TEXT,__text).
+// When end is 0 it's assumed to run to the end of the address space.
+int function_starts_find(
+  uint64_t *addresses,
+  int count,
+  uint64_t end,
+  uint64_t address);
+
+void function_starts_print(uint64_t *addresses, int count);
+
+#endif
+
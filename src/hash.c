@@ -0,0 +1,30 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+// 32 bit FNV-1a.
+uint32_t hash_string(const char *string)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*string != 0)
+  {
+    hash ^= (uint8_t)*string++;
+    hash *= 16777619;
+  }
+
+  return hash;
+}
+
@@ -0,0 +1,19 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+
+uint32_t hash_string(const char *string);
+
+#endif
+
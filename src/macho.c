@@ -77,6 +77,16 @@ const char *file_type[] =
   "Composite MachOs",
 };
 
+const char *data_in_code_kind[] =
+{
+  "???",
+  "Data",
+  "Jump table (8 bit)",
+  "Jump table (16 bit)",
+  "Jump table (32 bit)",
+  "Absolute jump table (32 bit)",
+};
+
 const char *get_cpu_type(int value)
 {
   int max = sizeof(cpu_type) / sizeof(char *);
@@ -135,6 +145,14 @@ const char *get_file_type(int value)
   return file_type[value];
 }
 
+const char *get_data_in_code_kind(int value)
+{
+  int max = sizeof(data_in_code_kind) / sizeof(char *);
+  if (value >= max) { return "???"; }
+
+  return data_in_code_kind[value];
+}
+
 int macho_read_header(MachoHeader *macho_header, FILE *fp)
 {
   memset(macho_header, 0, sizeof(MachoHeader));
@@ -163,6 +181,85 @@ int macho_read_header(MachoHeader *macho_header, FILE *fp)
   return 0;
 }
 
+static uint32_t read_uint32_be(FILE *fp)
+{
+  uint32_t value;
+
+  value = (uint32_t)getc(fp) << 24;
+  value |= (uint32_t)getc(fp) << 16;
+  value |= (uint32_t)getc(fp) << 8;
+  value |= (uint32_t)getc(fp);
+
+  return value;
+}
+
+// Universal binaries start with a big endian header listing a slice per
+// architecture. An arm64 slice is picked first, then x86_64, then
+// whichever is first. Returns -1 if fp isn't a universal binary (Java
+// class files share the 0xcafebabe magic but have a much larger count).
+int macho_read_fat_slice(MachoFatArch *macho_fat_arch, FILE *fp, long file_size)
+{
+  MachoFatArch macho_fat_arch_next;
+  uint32_t magic_number, count, n;
+  int found = -1, score = 0, next_score;
+
+  memset(macho_fat_arch, 0, sizeof(MachoFatArch));
+
+  fseek(fp, 0, SEEK_SET);
+
+  magic_number = read_uint32_be(fp);
+
+  if (magic_number != 0xcafebabe && magic_number != 0xcafebabf) { return -1; }
+
+  count = read_uint32_be(fp);
+
+  if (count == 0 || count > 32) { return -1; }
+
+  for (n = 0; n < count; n++)
+  {
+    macho_fat_arch_next.cpu_type = read_uint32_be(fp);
+    macho_fat_arch_next.cpu_subtype = read_uint32_be(fp);
+
+    if (magic_number == 0xcafebabf)
+    {
+      macho_fat_arch_next.offset = (uint64_t)read_uint32_be(fp) << 32;
+      macho_fat_arch_next.offset |= read_uint32_be(fp);
+      macho_fat_arch_next.size = (uint64_t)read_uint32_be(fp) << 32;
+      macho_fat_arch_next.size |= read_uint32_be(fp);
+      macho_fat_arch_next.align = read_uint32_be(fp);
+      read_uint32_be(fp);
+    }
+      else
+    {
+      macho_fat_arch_next.offset = read_uint32_be(fp);
+      macho_fat_arch_next.size = read_uint32_be(fp);
+      macho_fat_arch_next.align = read_uint32_be(fp);
+    }
+
+    if (macho_fat_arch_next.offset > file_size ||
+        macho_fat_arch_next.size > file_size - macho_fat_arch_next.offset)
+    {
+      continue;
+    }
+
+    switch (macho_fat_arch_next.cpu_type)
+    {
+      case 0x0100000c: next_score = 3; break;
+      case 0x01000007: next_score = 2; break;
+      default: next_score = 1; break;
+    }
+
+    if (next_score > score)
+    {
+      *macho_fat_arch = macho_fat_arch_next;
+      score = next_score;
+      found = 0;
+    }
+  }
+
+  return found;
+}
+
 int macho_read_load_command(MachoLoadCommand *macho_load_command, FILE *fp)
 {
   macho_load_command->type = read_uint32(fp);
@@ -279,6 +376,103 @@ int macho_read_dysymtab(MachoDysymtab *macho_dysymtab, FILE *fp)
   return 0;
 }
 
+int macho_read_linkedit_data(MachoLinkeditData *macho_linkedit_data, FILE *fp)
+{
+  macho_linkedit_data->data_offset = read_uint32(fp);
+  macho_linkedit_data->data_size = read_uint32(fp);
+
+  return 0;
+}
+
+int macho_read_data_in_code(MachoDataInCode *macho_data_in_code, FILE *fp)
+{
+  macho_data_in_code->offset = read_uint32(fp);
+  macho_data_in_code->length = read_uint16(fp);
+  macho_data_in_code->kind = read_uint16(fp);
+
+  return 0;
+}
+
+// Strings in load commands (lc_str) are an offset from the start of the
+// command and run to a 0 or the end of the command.
+static int read_command_string(
+  char *name,
+  FILE *fp,
+  long marker,
+  uint32_t offset,
+  uint32_t command_size)
+{
+  int n, ch;
+
+  name[0] = 0;
+
+  if (offset >= command_size) { return -1; }
+
+  fseek(fp, marker + offset, SEEK_SET);
+
+  for (n = 0; n < command_size - offset && n < MACHO_PATH_SIZE - 1; n++)
+  {
+    ch = getc(fp);
+    if (ch == 0 || ch == EOF) { break; }
+    name[n] = ch;
+  }
+
+  name[n] = 0;
+
+  return 0;
+}
+
+// Like the other readers this starts after the load command header, but
+// since the name is at the end it leaves fp at the end of the command.
+int macho_read_dylib(MachoDylib *macho_dylib, FILE *fp, uint32_t command_size)
+{
+  long marker = ftell(fp) - 8;
+  int error;
+
+  macho_dylib->name_offset = read_uint32(fp);
+  macho_dylib->timestamp = read_uint32(fp);
+  macho_dylib->current_version = read_uint32(fp);
+  macho_dylib->compatibility_version = read_uint32(fp);
+
+  if (macho_dylib->name_offset < 24)
+  {
+    macho_dylib->name[0] = 0;
+    error = -1;
+  }
+    else
+  {
+    error = read_command_string(macho_dylib->name, fp, marker,
+      macho_dylib->name_offset, command_size);
+  }
+
+  fseek(fp, marker + command_size, SEEK_SET);
+
+  return error;
+}
+
+int macho_read_rpath(MachoRpath *macho_rpath, FILE *fp, uint32_t command_size)
+{
+  long marker = ftell(fp) - 8;
+  int error;
+
+  macho_rpath->path_offset = read_uint32(fp);
+
+  if (macho_rpath->path_offset < 12)
+  {
+    macho_rpath->path[0] = 0;
+    error = -1;
+  }
+    else
+  {
+    error = read_command_string(macho_rpath->path, fp, marker,
+      macho_rpath->path_offset, command_size);
+  }
+
+  fseek(fp, marker + command_size, SEEK_SET);
+
+  return error;
+}
+
 void macho_print_header(MachoHeader *macho_header)
 {
   printf(" -- MachO Header --\n");
@@ -443,3 +637,63 @@ void macho_print_dysymtab(MachoDysymtab *macho_dysymtab, FILE *fp)
   printf("\n");
 }
 
+void macho_print_linkedit_data(MachoLinkeditData *macho_linkedit_data)
+{
+  printf("  data_offset: 0x%04x\n", macho_linkedit_data->data_offset);
+  printf("    data_size: %d\n", macho_linkedit_data->data_size);
+  printf("\n");
+}
+
+void macho_print_data_in_code(MachoLinkeditData *macho_linkedit_data, FILE *fp)
+{
+  MachoDataInCode macho_data_in_code;
+  long marker;
+  int count = macho_linkedit_data->data_size / 8;
+  int n;
+
+  printf(" -- Data In Code --\n");
+  printf("  count: %d\n", count);
+
+  marker = ftell(fp);
+  fseek(fp, macho_linkedit_data->data_offset, SEEK_SET);
+
+  for (n = 0; n < count; n++)
+  {
+    macho_read_data_in_code(&macho_data_in_code, fp);
+
+    printf("  %d) offset=0x%04x length=%d kind=%d (%s)\n",
+      n,
+      macho_data_in_code.offset,
+      macho_data_in_code.length,
+      macho_data_in_code.kind,
+      get_data_in_code_kind(macho_data_in_code.kind));
+  }
+
+  printf("\n");
+
+  fseek(fp, marker, SEEK_SET);
+}
+
+void macho_print_dylib(MachoDylib *macho_dylib)
+{
+  printf(" -- Dylib --\n");
+  printf("                 name: %s\n", macho_dylib->name);
+  printf("            timestamp: %d\n", macho_dylib->timestamp);
+  printf("      current_version: %d.%d.%d\n",
+    macho_dylib->current_version >> 16,
+    (macho_dylib->current_version >> 8) & 0xff,
+    macho_dylib->current_version & 0xff);
+  printf("compatibility_version: %d.%d.%d\n",
+    macho_dylib->compatibility_version >> 16,
+    (macho_dylib->compatibility_version >> 8) & 0xff,
+    macho_dylib->compatibility_version & 0xff);
+  printf("\n");
+}
+
+void macho_print_rpath(MachoRpath *macho_rpath)
+{
+  printf(" -- Rpath --\n");
+  printf("  path: %s\n", macho_rpath->path);
+  printf("\n");
+}
+
@@ -117,13 +117,62 @@ typedef struct MachoDysymtab
   uint32_t local_reloc_count;
 } MachoDysymtab;
 
+typedef struct MachoLinkeditData
+{
+  uint32_t data_offset;
+  uint32_t data_size;
+} MachoLinkeditData;
+
+typedef struct MachoDataInCode
+{
+  uint32_t offset;
+  uint16_t length;
+  uint16_t kind;
+} MachoDataInCode;
+
+// One architecture in a universal (fat) binary.
+typedef struct MachoFatArch
+{
+  uint32_t cpu_type;
+  uint32_t cpu_subtype;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t align;
+} MachoFatArch;
+
+#define MACHO_PATH_SIZE 1024
+
+// LC_ID_DYLIB, LC_LOAD_DYLIB, LC_LOAD_WEAK_DYLIB, LC_REEXPORT_DYLIB, etc.
+typedef struct MachoDylib
+{
+  uint32_t name_offset;
+  uint32_t timestamp;
+  uint32_t current_version;
+  uint32_t compatibility_version;
+  char name[MACHO_PATH_SIZE];
+} MachoDylib;
+
+typedef struct MachoRpath
+{
+  uint32_t path_offset;
+  char path[MACHO_PATH_SIZE];
+} MachoRpath;
+
+const char *get_cpu_type(int value);
+const char *get_file_type(int value);
+
 int macho_read_header(MachoHeader *macho_header, FILE *fp);
+int macho_read_fat_slice(MachoFatArch *macho_fat_arch, FILE *fp, long file_size);
 int macho_read_load_command(MachoLoadCommand *macho_load_command, FILE *fp);
 int macho_read_segment_load(MachoSegmentLoad *macho_segement_load, FILE *fp, int bits);
 int macho_read_section(MachoSection *macho_section, FILE *fp, int bits);
 int macho_read_symtab(MachoSymtab *macho_symtab, FILE *fp);
 int macho_read_symbol(MachoSymbol *macho_symbol, FILE *fp, int bits);
 int macho_read_dysymtab(MachoDysymtab *macho_symtab, FILE *fp);
+int macho_read_linkedit_data(MachoLinkeditData *macho_linkedit_data, FILE *fp);
+int macho_read_data_in_code(MachoDataInCode *macho_data_in_code, FILE *fp);
+int macho_read_dylib(MachoDylib *macho_dylib, FILE *fp, uint32_t command_size);
+int macho_read_rpath(MachoRpath *macho_rpath, FILE *fp, uint32_t command_size);
 
 void macho_print_header(MachoHeader *macho_header);
 void macho_print_load_command(MachoLoadCommand *macho_load_command);
@@ -132,6 +181,10 @@ void macho_print_section(MachoSection *macho_section);
 void macho_print_symtab(MachoSymtab *macho_symtab, FILE *fp, int bits);
 void macho_print_symbol(MachoSymbol *macho_symbol, FILE *fp, long symtab);
 void macho_print_dysymtab(MachoDysymtab *macho_dysymtab, FILE *fp);
+void macho_print_linkedit_data(MachoLinkeditData *macho_linkedit_data);
+void macho_print_data_in_code(MachoLinkeditData *macho_linkedit_data, FILE *fp);
+void macho_print_dylib(MachoDylib *macho_dylib);
+void macho_print_rpath(MachoRpath *macho_rpath);
 
 #endif
 
@@ -0,0 +1,326 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "function_starts.h"
+#include "macho_model.h"
+
+static int load_segment(MachoModel *model, FILE *fp, uint32_t command_size)
+{
+  MachoSegmentLoad macho_segment_load;
+  int n;
+
+  if (macho_read_segment_load(&macho_segment_load, fp, model->bits) != 0)
+  {
+    return -1;
+  }
+
+  MachoSegmentLoad *segments = realloc(model->segments,
+    (model->segment_count + 1) * sizeof(MachoSegmentLoad));
+  if (segments == NULL) { return -1; }
+
+  model->segments = segments;
+  model->segments[model->segment_count++] = macho_segment_load;
+
+  // The sections have to fit in the load command.
+  if (macho_segment_load.section_count >
+      command_size / (model->bits == 32 ? 68 : 80))
+  {
+    return -1;
+  }
+
+  MachoSection *sections = realloc(model->sections,
+    (model->section_count + macho_segment_load.section_count) *
+    sizeof(MachoSection));
+  if (sections == NULL && macho_segment_load.section_count != 0) { return -1; }
+
+  model->sections = sections;
+
+  for (n = 0; n < macho_segment_load.section_count; n++)
+  {
+    if (macho_read_section(&model->sections[model->section_count], fp, model->bits) != 0)
+    {
+      return -1;
+    }
+
+    model->section_count++;
+  }
+
+  return 0;
+}
+
+static int load_symtab(MachoModel *model, FILE *fp, long base, long file_size)
+{
+  MachoSymtab macho_symtab;
+  int symbol_size = model->bits == 32 ? 12 : 16;
+  int n;
+
+  macho_read_symtab(&macho_symtab, fp);
+
+  if ((uint64_t)macho_symtab.symbol_count * symbol_size >
+        file_size - (uint64_t)macho_symtab.symbol_table_offset ||
+      macho_symtab.symbol_table_offset > file_size ||
+      macho_symtab.string_table_offset > file_size ||
+      macho_symtab.string_table_size > file_size - macho_symtab.string_table_offset)
+  {
+    return -1;
+  }
+
+  free(model->string_table);
+  free(model->symbols);
+
+  // The string table gets an extra 0 so a name can't run off the end.
+  model->string_table = malloc(macho_symtab.string_table_size + 1);
+  model->symbols = malloc((macho_symtab.symbol_count + 1) * sizeof(MachoSymbol));
+
+  if (model->string_table == NULL || model->symbols == NULL) { return -1; }
+
+  fseek(fp, base + macho_symtab.string_table_offset, SEEK_SET);
+
+  if (fread(model->string_table, 1, macho_symtab.string_table_size, fp) !=
+      macho_symtab.string_table_size)
+  {
+    return -1;
+  }
+
+  model->string_table[macho_symtab.string_table_size] = 0;
+  model->string_table_size = macho_symtab.string_table_size;
+
+  fseek(fp, base + macho_symtab.symbol_table_offset, SEEK_SET);
+
+  for (n = 0; n < macho_symtab.symbol_count; n++)
+  {
+    macho_read_symbol(&model->symbols[n], fp, model->bits);
+  }
+
+  model->symbol_count = macho_symtab.symbol_count;
+
+  return 0;
+}
+
+static int load_dylib(MachoModel *model, FILE *fp, MachoLoadCommand *macho_load_command)
+{
+  MachoDylib macho_dylib;
+
+  if (macho_read_dylib(&macho_dylib, fp, macho_load_command->size) != 0)
+  {
+    return -1;
+  }
+
+  // LC_ID_DYLIB
+  if (macho_load_command->type == 0x0000000d)
+  {
+    free(model->install_name);
+    model->install_name = strdup(macho_dylib.name);
+
+    return model->install_name == NULL ? -1 : 0;
+  }
+
+  MachoModelDylib *dylibs = realloc(model->dylibs,
+    (model->dylib_count + 1) * sizeof(MachoModelDylib));
+  if (dylibs == NULL) { return -1; }
+
+  model->dylibs = dylibs;
+
+  MachoModelDylib *dylib = &model->dylibs[model->dylib_count];
+
+  dylib->type = macho_load_command->type;
+  dylib->current_version = macho_dylib.current_version;
+  dylib->compatibility_version = macho_dylib.compatibility_version;
+  dylib->name = strdup(macho_dylib.name);
+
+  if (dylib->name == NULL) { return -1; }
+
+  model->dylib_count++;
+
+  return 0;
+}
+
+static int load_rpath(MachoModel *model, FILE *fp, uint32_t command_size)
+{
+  MachoRpath macho_rpath;
+
+  if (macho_read_rpath(&macho_rpath, fp, command_size) != 0) { return -1; }
+
+  char **rpaths = realloc(model->rpaths, (model->rpath_count + 1) * sizeof(char *));
+  if (rpaths == NULL) { return -1; }
+
+  model->rpaths = rpaths;
+  model->rpaths[model->rpath_count] = strdup(macho_rpath.path);
+
+  if (model->rpaths[model->rpath_count] == NULL) { return -1; }
+
+  model->rpath_count++;
+
+  return 0;
+}
+
+int macho_model_load(MachoModel *model, const char *filename)
+{
+  MachoLoadCommand macho_load_command;
+  MachoLinkeditData macho_linkedit_data;
+  uint64_t text_address = 0;
+  MachoFatArch macho_fat_arch;
+  long file_size, marker, base = 0;
+  FILE *fp;
+  int i, error = 0;
+
+  memset(model, 0, sizeof(MachoModel));
+
+  fp = fopen(filename, "rb");
+  if (fp == NULL) { return -1; }
+
+  fseek(fp, 0, SEEK_END);
+  file_size = ftell(fp);
+
+  // Offsets in a slice of a universal binary are from the slice start.
+  if (macho_read_fat_slice(&macho_fat_arch, fp, file_size) == 0)
+  {
+    base = macho_fat_arch.offset;
+    file_size = macho_fat_arch.size;
+  }
+
+  fseek(fp, base, SEEK_SET);
+
+  if (macho_read_header(&model->header, fp) != 0)
+  {
+    fclose(fp);
+    return -1;
+  }
+
+  model->bits = (model->header.cpu_type & 0x01000000) == 0x01000000 ? 64 : 32;
+
+  for (i = 0; i < model->header.load_command_count && error == 0; i++)
+  {
+    marker = ftell(fp) - base;
+
+    macho_read_load_command(&macho_load_command, fp);
+
+    if (macho_load_command.size < 8 ||
+        macho_load_command.size > file_size - marker)
+    {
+      error = -1;
+      break;
+    }
+
+    switch (macho_load_command.type)
+    {
+      case 0x00000001:
+      case 0x00000019:
+        // LC_SEGMENT_32
+        // LC_SEGMENT_64
+        error = load_segment(model, fp, macho_load_command.size);
+
+        if (error == 0 &&
+            strncmp(model->segments[model->segment_count - 1].name, "__TEXT", 16) == 0)
+        {
+          text_address = model->segments[model->segment_count - 1].address;
+        }
+        break;
+      case 0x00000002:
+        // LC_SYMTAB
+        error = load_symtab(model, fp, base, file_size);
+        break;
+      case 0x0000000b:
+        // LC_DYSYMTAB
+        macho_read_dysymtab(&model->dysymtab, fp);
+        model->has_dysymtab = 1;
+        break;
+      case 0x0000000c:
+      case 0x0000000d:
+      case 0x00000020:
+      case 0x80000018:
+      case 0x8000001f:
+      case 0x80000023:
+        // LC_LOAD_DYLIB
+        // LC_ID_DYLIB
+        // LC_LAZY_LOAD_DYLIB
+        // LC_LOAD_WEAK_DYLIB
+        // LC_REEXPORT_DYLIB
+        // LC_LOAD_UPWARD_DYLIB
+        error = load_dylib(model, fp, &macho_load_command);
+        break;
+      case 0x8000001c:
+        // LC_RPATH
+        error = load_rpath(model, fp, macho_load_command.size);
+        break;
+      case 0x00000026:
+        // LC_FUNCTION_STARTS
+        macho_read_linkedit_data(&macho_linkedit_data, fp);
+
+        if (macho_linkedit_data.data_offset > file_size ||
+            macho_linkedit_data.data_size > file_size - macho_linkedit_data.data_offset)
+        {
+          break;
+        }
+
+        macho_linkedit_data.data_offset += base;
+
+        free(model->function_starts);
+        model->function_start_count = function_starts_read(
+          &macho_linkedit_data, fp, text_address, &model->function_starts);
+
+        if (model->function_start_count < 0) { model->function_start_count = 0; }
+        break;
+      default:
+        break;
+    }
+
+    fseek(fp, base + marker + macho_load_command.size, SEEK_SET);
+  }
+
+  fclose(fp);
+
+  if (error != 0)
+  {
+    macho_model_free(model);
+    return -1;
+  }
+
+  return 0;
+}
+
+void macho_model_free(MachoModel *model)
+{
+  int n;
+
+  for (n = 0; n < model->dylib_count; n++)
+  {
+    free(model->dylibs[n].name);
+  }
+
+  for (n = 0; n < model->rpath_count; n++)
+  {
+    free(model->rpaths[n]);
+  }
+
+  free(model->segments);
+  free(model->sections);
+  free(model->symbols);
+  free(model->string_table);
+  free(model->function_starts);
+  free(model->install_name);
+  free(model->dylibs);
+  free(model->rpaths);
+
+  memset(model, 0, sizeof(MachoModel));
+}
+
+const char *macho_model_symbol_name(MachoModel *model, MachoSymbol *macho_symbol)
+{
+  if (macho_symbol->string_index >= model->string_table_size) { return ""; }
+
+  return model->string_table + macho_symbol->string_index;
+}
+
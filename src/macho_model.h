@@ -0,0 +1,59 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef MACHO_MODEL_H
+#define MACHO_MODEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "macho.h"
+
+// A dylib this file links against. The position in the list is the
+// library ordinal (starting at 1) used by its undefined symbols.
+typedef struct MachoModelDylib
+{
+  uint32_t type;
+  uint32_t current_version;
+  uint32_t compatibility_version;
+  char *name;
+} MachoModelDylib;
+
+// Everything needed to answer queries about a file without going back
+// to it. Unlike parse_macho() nothing is printed while loading.
+typedef struct MachoModel
+{
+  MachoHeader header;
+  int bits;
+  MachoSegmentLoad *segments;
+  int segment_count;
+  MachoSection *sections;
+  int section_count;
+  MachoSymbol *symbols;
+  int symbol_count;
+  char *string_table;
+  uint32_t string_table_size;
+  MachoDysymtab dysymtab;
+  int has_dysymtab;
+  uint64_t *function_starts;
+  int function_start_count;
+  char *install_name;
+  MachoModelDylib *dylibs;
+  int dylib_count;
+  char **rpaths;
+  int rpath_count;
+} MachoModel;
+
+int macho_model_load(MachoModel *model, const char *filename);
+void macho_model_free(MachoModel *model);
+const char *macho_model_symbol_name(MachoModel *model, MachoSymbol *macho_symbol);
+
+#endif
+
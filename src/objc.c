@@ -0,0 +1,622 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "objc.h"
+
+#define METHOD_LIST_FLAG_MASK        0xffff0003
+#define METHOD_LIST_SMALL            0x80000000
+#define METHOD_LIST_DIRECT_SELECTORS 0x40000000
+
+#define SWIFT_RECORD_DIRECT   0
+#define SWIFT_RECORD_INDIRECT 1
+
+#define SWIFT_KIND_EXTENSION 1
+#define SWIFT_KIND_ANONYMOUS 2
+
+// Nested Swift types are named by walking up this many parents at most.
+#define SWIFT_MAX_DEPTH 8
+
+static const char *swift_kinds[] =
+{
+  "module",
+  "extension",
+  "anonymous",
+  "protocol",
+  "opaque_type",
+};
+
+static const char *swift_type_kinds[] =
+{
+  "class",
+  "struct",
+  "enum",
+};
+
+static const char *get_swift_kind(int kind)
+{
+  if (kind < sizeof(swift_kinds) / sizeof(char *))
+  {
+    return swift_kinds[kind];
+  }
+
+  if (kind >= 16 && kind - 16 < sizeof(swift_type_kinds) / sizeof(char *))
+  {
+    return swift_type_kinds[kind - 16];
+  }
+
+  return "unknown";
+}
+
+static int objc_read(Objc *objc, uint64_t address, uint8_t *data, int length)
+{
+  uint64_t file_offset;
+
+  if (address_map_translate(&objc->address_map, address, length, &file_offset) != 0)
+  {
+    return -1;
+  }
+
+  if (fseek(objc->fp, file_offset, SEEK_SET) != 0) { return -1; }
+  if (fread(data, 1, length, objc->fp) != length) { return -1; }
+
+  return 0;
+}
+
+static int objc_read_value(Objc *objc, uint64_t address, int size, uint64_t *value)
+{
+  uint8_t data[8];
+  int n;
+
+  *value = 0;
+
+  if (objc_read(objc, address, data, size) != 0) { return -1; }
+
+  for (n = size - 1; n >= 0; n--)
+  {
+    *value = (*value << 8) | data[n];
+  }
+
+  return 0;
+}
+
+// Relative pointers are signed 32 bit offsets from their own address.
+static int objc_read_relative(Objc *objc, uint64_t address, uint64_t *target)
+{
+  uint64_t value;
+
+  if (objc_read_value(objc, address, 4, &value) != 0) { return -1; }
+
+  *target = address + (int64_t)(int32_t)value;
+
+  return 0;
+}
+
+static int objc_read_string(Objc *objc, uint64_t address, char *name)
+{
+  uint64_t file_offset;
+  int n, c;
+
+  name[0] = 0;
+
+  if (address_map_translate(&objc->address_map, address, 1, &file_offset) != 0)
+  {
+    return -1;
+  }
+
+  if (fseek(objc->fp, file_offset, SEEK_SET) != 0) { return -1; }
+
+  for (n = 0; n < OBJC_NAME_SIZE - 1; n++)
+  {
+    c = getc(objc->fp);
+    if (c == EOF || c == 0) { break; }
+    name[n] = c;
+  }
+
+  name[n] = 0;
+
+  return 0;
+}
+
+// Nothing Objective-C or Swift metadata points to lives in the Mach-O
+// header, so a target there is a misread bind ordinal or addend.
+static int objc_is_target(Objc *objc, uint64_t address)
+{
+  uint64_t file_offset;
+
+  if (address >= objc->text_address && address < objc->header_end)
+  {
+    return 0;
+  }
+
+  return address_map_translate(&objc->address_map, address, 1, &file_offset) == 0;
+}
+
+// Returns the address a pointer in the file refers to or 0 if it doesn't
+// point into the file. Chained fixups replace rebased pointers with the
+// target in the low bits (36, or 43 on arm64e), either as an address or
+// (for the _OFFSET and arm64e userland formats) as an offset from the
+// start of the image. Binds set bit 63, except on arm64e where bit 63
+// marks a signed pointer and bit 62 a bind. Neither is followed.
+static uint64_t objc_pointer(Objc *objc, uint64_t value)
+{
+  uint64_t target;
+
+  if (value == 0) { return 0; }
+
+  if (objc_is_target(objc, value)) { return value; }
+
+  if (objc->bits != 64) { return 0; }
+
+  if (objc->arm64e)
+  {
+    if ((value >> 62) != 0) { return 0; }
+
+    target = value & 0x7ffffffffffULL;
+  }
+    else
+  {
+    if ((value >> 63) != 0) { return 0; }
+
+    target = value & 0xfffffffffULL;
+  }
+
+  if (objc_is_target(objc, target)) { return target; }
+
+  target += objc->text_address;
+
+  if (objc_is_target(objc, target)) { return target; }
+
+  return 0;
+}
+
+static int objc_read_pointer(Objc *objc, uint64_t address, uint64_t *pointer)
+{
+  uint64_t value;
+
+  if (objc_read_value(objc, address, objc->bits / 8, &value) != 0)
+  {
+    *pointer = 0;
+    return -1;
+  }
+
+  *pointer = objc_pointer(objc, value);
+
+  return 0;
+}
+
+// A section size that doesn't fit in its segment would otherwise have the
+// iterators count through entries that can't be read.
+static int objc_section_readable(Objc *objc, MachoSection *macho_section)
+{
+  uint64_t file_offset;
+
+  if (macho_section->size == 0) { return 0; }
+
+  return address_map_translate(
+    &objc->address_map,
+    macho_section->address,
+    macho_section->size,
+    &file_offset) == 0;
+}
+
+void objc_init(Objc *objc, FILE *fp, MachoHeader *macho_header)
+{
+  memset(objc, 0, sizeof(Objc));
+
+  objc->fp = fp;
+  objc->bits = (macho_header->cpu_type & 0x01000000) == 0x01000000 ? 64 : 32;
+
+  // CPU_TYPE_ARM64 with CPU_SUBTYPE_ARM64E.
+  objc->arm64e = macho_header->cpu_type == 0x0100000c &&
+                 (macho_header->cpu_subtype & 0xff) == 2;
+
+  objc->header_size = (objc->bits == 64 ? 32 : 28) +
+                      macho_header->load_command_size;
+
+  address_map_init(&objc->address_map);
+}
+
+void objc_free(Objc *objc)
+{
+  address_map_free(&objc->address_map);
+
+  memset(objc, 0, sizeof(Objc));
+}
+
+int objc_add_segment(Objc *objc, MachoSegmentLoad *macho_segment_load)
+{
+  if (strncmp(macho_segment_load->name, "__TEXT", 16) == 0)
+  {
+    objc->text_address = macho_segment_load->address;
+
+    // The header and load commands are mapped at the start of __TEXT.
+    if (macho_segment_load->file_offset == 0)
+    {
+      objc->header_end = macho_segment_load->address + objc->header_size;
+    }
+  }
+
+  return address_map_add(&objc->address_map, macho_segment_load);
+}
+
+void objc_add_section(Objc *objc, MachoSection *macho_section)
+{
+  if (strncmp(macho_section->section_name, "__objc_classlist", 16) == 0)
+  {
+    objc->classlist = *macho_section;
+  }
+    else
+  if (strncmp(macho_section->section_name, "__swift5_types", 16) == 0)
+  {
+    objc->swift_types = *macho_section;
+  }
+}
+
+// Follows a class to its class_ro_t for the name, flags and instance
+// methods. The metaclass (isa) holds the class methods the same way.
+int objc_read_class(Objc *objc, uint64_t address, ObjcClass *objc_class)
+{
+  int pointer_size = objc->bits / 8;
+  uint64_t name_address, data;
+
+  memset(objc_class, 0, sizeof(ObjcClass));
+  objc_class->address = address;
+
+  // isa, superclass, cache, vtable, data.
+  objc_read_pointer(objc, address, &objc_class->metaclass);
+  objc_read_pointer(objc, address + pointer_size * 4, &data);
+
+  // The low bits of data are flags (Swift class, etc).
+  objc_class->ro_address = data & (objc->bits == 64 ? ~7ULL : ~3ULL);
+
+  if (objc_class->ro_address == 0) { return -1; }
+
+  // flags, instanceStart, instanceSize, [reserved,] ivarLayout, name,
+  // baseMethods.
+  uint64_t ro = objc_class->ro_address;
+  uint64_t value;
+  int name_offset = objc->bits == 64 ? 24 : 16;
+
+  if (objc_read_value(objc, ro, 4, &value) != 0) { return -1; }
+  objc_class->flags = value;
+
+  if (objc_read_value(objc, ro + 8, 4, &value) != 0) { return -1; }
+  objc_class->instance_size = value;
+
+  objc_read_pointer(objc, ro + name_offset, &name_address);
+  objc_read_pointer(objc, ro + name_offset + pointer_size, &objc_class->method_list);
+
+  objc_read_string(objc, name_address, objc_class->name);
+
+  return 0;
+}
+
+void objc_class_iterator_init(ObjcClassIterator *iterator, Objc *objc)
+{
+  iterator->objc = objc;
+  iterator->index = 0;
+  iterator->count = 0;
+
+  if (objc_section_readable(objc, &objc->classlist))
+  {
+    iterator->count = objc->classlist.size / (objc->bits / 8);
+  }
+}
+
+// Returns -1 after the last class. A class that can't be followed is
+// still returned, but with a ro_address of 0.
+int objc_class_next(ObjcClassIterator *iterator, ObjcClass *objc_class)
+{
+  Objc *objc = iterator->objc;
+  uint64_t address;
+
+  if (iterator->index >= iterator->count) { return -1; }
+
+  address = objc->classlist.address + iterator->index * (objc->bits / 8);
+  iterator->index++;
+
+  objc_read_pointer(objc, address, &address);
+
+  if (address == 0 || objc_read_class(objc, address, objc_class) != 0)
+  {
+    memset(objc_class, 0, sizeof(ObjcClass));
+    objc_class->address = address;
+  }
+
+  return 0;
+}
+
+int objc_method_iterator_init(
+  ObjcMethodIterator *iterator,
+  Objc *objc,
+  uint64_t method_list)
+{
+  uint64_t value;
+
+  memset(iterator, 0, sizeof(ObjcMethodIterator));
+  iterator->objc = objc;
+
+  if (method_list == 0) { return 0; }
+
+  // entsizeAndFlags, count.
+  if (objc_read_value(objc, method_list, 8, &value) != 0) { return -1; }
+
+  iterator->address = method_list + 8;
+  iterator->flags = value & METHOD_LIST_FLAG_MASK;
+  iterator->entry_size = value & ~METHOD_LIST_FLAG_MASK & 0xffffffff;
+  iterator->count = value >> 32;
+
+  // Small methods are three 32 bit relative offsets, the others are
+  // name, types and imp pointers.
+  if (iterator->entry_size <
+      ((iterator->flags & METHOD_LIST_SMALL) != 0 ? 12 : 3 * (objc->bits / 8)))
+  {
+    iterator->count = 0;
+    return -1;
+  }
+
+  return 0;
+}
+
+int objc_method_next(ObjcMethodIterator *iterator, ObjcMethod *objc_method)
+{
+  Objc *objc = iterator->objc;
+  int pointer_size = objc->bits / 8;
+  uint64_t name, types;
+
+  if (iterator->index >= iterator->count) { return -1; }
+
+  uint64_t entry = iterator->address +
+    (uint64_t)iterator->index * iterator->entry_size;
+
+  iterator->index++;
+
+  memset(objc_method, 0, sizeof(ObjcMethod));
+
+  if ((iterator->flags & METHOD_LIST_SMALL) != 0)
+  {
+    if (objc_read_relative(objc, entry, &name) != 0 ||
+        objc_read_relative(objc, entry + 4, &types) != 0 ||
+        objc_read_relative(objc, entry + 8, &objc_method->imp) != 0)
+    {
+      iterator->count = 0;
+      return -1;
+    }
+
+    // Unless the selectors are direct, name is a selector reference.
+    if ((iterator->flags & METHOD_LIST_DIRECT_SELECTORS) == 0)
+    {
+      objc_read_pointer(objc, name, &name);
+    }
+  }
+    else
+  {
+    if (objc_read_pointer(objc, entry, &name) != 0 ||
+        objc_read_pointer(objc, entry + pointer_size, &types) != 0 ||
+        objc_read_pointer(objc, entry + pointer_size * 2, &objc_method->imp) != 0)
+    {
+      iterator->count = 0;
+      return -1;
+    }
+  }
+
+  objc_read_string(objc, name, objc_method->name);
+  objc_read_string(objc, types, objc_method->types);
+
+  return 0;
+}
+
+void swift_type_iterator_init(SwiftTypeIterator *iterator, Objc *objc)
+{
+  iterator->objc = objc;
+  iterator->index = 0;
+  iterator->count = 0;
+
+  if (objc_section_readable(objc, &objc->swift_types))
+  {
+    iterator->count = objc->swift_types.size / 4;
+  }
+}
+
+// Each entry of __swift5_types is a relative offset to a context
+// descriptor: flags, parent, name. Names of nested types are built by
+// following the parents (Module.Outer.Inner).
+int swift_type_next(SwiftTypeIterator *iterator, SwiftType *swift_type)
+{
+  Objc *objc = iterator->objc;
+  char part[OBJC_NAME_SIZE];
+  uint64_t address, value;
+  int depth, kind, length;
+
+  if (iterator->index >= iterator->count) { return -1; }
+
+  memset(swift_type, 0, sizeof(SwiftType));
+  swift_type->kind = -1;
+
+  address = objc->swift_types.address + iterator->index * 4;
+  iterator->index++;
+
+  // The low 2 bits of each record are its kind. Records that name an
+  // Objective-C class instead of a descriptor are left unresolved.
+  if (objc_read_value(objc, address, 4, &value) != 0) { return 0; }
+
+  address = address + (int64_t)(int32_t)(value & ~3ULL);
+
+  switch (value & 3)
+  {
+    case SWIFT_RECORD_DIRECT:
+      break;
+    case SWIFT_RECORD_INDIRECT:
+      if (objc_read_pointer(objc, address, &address) != 0) { return 0; }
+      break;
+    default:
+      return 0;
+  }
+
+  swift_type->address = address;
+
+  for (depth = 0; depth < SWIFT_MAX_DEPTH && address != 0; depth++)
+  {
+    if (objc_read_value(objc, address, 4, &value) != 0) { break; }
+
+    kind = value & 0x1f;
+
+    if (depth == 0) { swift_type->kind = kind; }
+
+    if (kind == SWIFT_KIND_EXTENSION || kind == SWIFT_KIND_ANONYMOUS)
+    {
+      snprintf(part, sizeof(part), "(%s)", get_swift_kind(kind));
+    }
+      else
+    if (objc_read_relative(objc, address + 8, &value) != 0 ||
+        objc_read_string(objc, value, part) != 0)
+    {
+      break;
+    }
+
+    if (depth != 0)
+    {
+      // Keep the name found so far once the parents don't fit.
+      length = strlen(part);
+      if (length + 1 + strlen(swift_type->name) >= OBJC_NAME_SIZE) { break; }
+
+      part[length] = '.';
+      strcpy(part + length + 1, swift_type->name);
+    }
+
+    strcpy(swift_type->name, part);
+
+    // The parent offset has bit 0 set when it points at a pointer to the
+    // parent instead of the parent itself.
+    if (objc_read_value(objc, address + 4, 4, &value) != 0 || value == 0)
+    {
+      break;
+    }
+
+    address = address + 4 + (int64_t)(int32_t)(value & ~1ULL);
+
+    if ((value & 1) != 0) { objc_read_pointer(objc, address, &address); }
+  }
+
+  return 0;
+}
+
+static void objc_print_methods(Objc *objc, uint64_t method_list, char type, int limit)
+{
+  ObjcMethodIterator iterator;
+  ObjcMethod objc_method;
+  int n = 0;
+
+  if (objc_method_iterator_init(&iterator, objc, method_list) != 0)
+  {
+    printf("       %c (method list at 0x%lx not readable)\n", type, method_list);
+    return;
+  }
+
+  while (objc_method_next(&iterator, &objc_method) == 0)
+  {
+    if (limit > 0 && n == limit)
+    {
+      printf("       %c ... %d more\n", type, iterator.count - n);
+      break;
+    }
+
+    printf("       %c %s %s imp=0x%lx\n",
+      type, objc_method.name, objc_method.types, objc_method.imp);
+
+    n++;
+  }
+}
+
+// Classes are decoded one at a time and methods only when asked for.
+// With a limit of 0 everything is printed, otherwise no more than limit
+// classes, Swift types and methods per class.
+void objc_print(Objc *objc, int methods, int limit)
+{
+  ObjcClassIterator class_iterator;
+  SwiftTypeIterator swift_iterator;
+  ObjcClass objc_class, objc_metaclass;
+  SwiftType swift_type;
+  int n;
+
+  objc_class_iterator_init(&class_iterator, objc);
+
+  printf(" -- Objective-C Classes --\n");
+  printf("  count: %lu\n", class_iterator.count);
+
+  for (n = 0; objc_class_next(&class_iterator, &objc_class) == 0; n++)
+  {
+    if (limit > 0 && n == limit)
+    {
+      printf("  ... %lu more\n", class_iterator.count - n);
+      break;
+    }
+
+    if (objc_class.ro_address == 0)
+    {
+      printf("  %d) (unresolved) class=0x%lx\n", n, objc_class.address);
+      continue;
+    }
+
+    printf("  %d) %s class=0x%lx ro=0x%lx flags=0x%x instance_size=%d\n",
+      n,
+      objc_class.name,
+      objc_class.address,
+      objc_class.ro_address,
+      objc_class.flags,
+      objc_class.instance_size);
+
+    if (methods == 0) { continue; }
+
+    objc_print_methods(objc, objc_class.method_list, '-', limit);
+
+    if (objc_class.metaclass != 0 &&
+        objc_read_class(objc, objc_class.metaclass, &objc_metaclass) == 0)
+    {
+      objc_print_methods(objc, objc_metaclass.method_list, '+', limit);
+    }
+  }
+
+  printf("\n");
+
+  swift_type_iterator_init(&swift_iterator, objc);
+
+  printf(" -- Swift Types --\n");
+  printf("  count: %lu\n", swift_iterator.count);
+
+  for (n = 0; swift_type_next(&swift_iterator, &swift_type) == 0; n++)
+  {
+    if (limit > 0 && n == limit)
+    {
+      printf("  ... %lu more\n", swift_iterator.count - n);
+      break;
+    }
+
+    if (swift_type.kind < 0)
+    {
+      printf("  %d) (unresolved)\n", n);
+      continue;
+    }
+
+    printf("  %d) %s %s descriptor=0x%lx\n",
+      n,
+      get_swift_kind(swift_type.kind),
+      swift_type.name,
+      swift_type.address);
+  }
+
+  printf("\n");
+}
+
@@ -0,0 +1,105 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef OBJC_H
+#define OBJC_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "address_map.h"
+#include "macho.h"
+
+#define OBJC_NAME_SIZE 256
+
+typedef struct Objc
+{
+  FILE *fp;
+  int bits;
+  int arm64e;
+  uint32_t header_size;
+  uint64_t text_address;
+  uint64_t header_end;
+  AddressMap address_map;
+  MachoSection classlist;
+  MachoSection swift_types;
+} Objc;
+
+typedef struct ObjcClass
+{
+  uint64_t address;
+  uint64_t metaclass;
+  uint64_t ro_address;
+  uint64_t method_list;
+  uint32_t flags;
+  uint32_t instance_size;
+  char name[OBJC_NAME_SIZE];
+} ObjcClass;
+
+typedef struct ObjcMethod
+{
+  uint64_t imp;
+  char name[OBJC_NAME_SIZE];
+  char types[OBJC_NAME_SIZE];
+} ObjcMethod;
+
+typedef struct SwiftType
+{
+  uint64_t address;
+  int kind;
+  char name[OBJC_NAME_SIZE];
+} SwiftType;
+
+// Iterators read one entry per call so nothing is decoded until it's
+// asked for.
+typedef struct ObjcClassIterator
+{
+  Objc *objc;
+  uint64_t index;
+  uint64_t count;
+} ObjcClassIterator;
+
+typedef struct ObjcMethodIterator
+{
+  Objc *objc;
+  uint64_t address;
+  uint32_t entry_size;
+  uint32_t flags;
+  uint32_t index;
+  uint32_t count;
+} ObjcMethodIterator;
+
+typedef struct SwiftTypeIterator
+{
+  Objc *objc;
+  uint64_t index;
+  uint64_t count;
+} SwiftTypeIterator;
+
+void objc_init(Objc *objc, FILE *fp, MachoHeader *macho_header);
+void objc_free(Objc *objc);
+int objc_add_segment(Objc *objc, MachoSegmentLoad *macho_segment_load);
+void objc_add_section(Objc *objc, MachoSection *macho_section);
+
+int objc_read_class(Objc *objc, uint64_t address, ObjcClass *objc_class);
+void objc_class_iterator_init(ObjcClassIterator *iterator, Objc *objc);
+int objc_class_next(ObjcClassIterator *iterator, ObjcClass *objc_class);
+int objc_method_iterator_init(
+  ObjcMethodIterator *iterator,
+  Objc *objc,
+  uint64_t method_list);
+int objc_method_next(ObjcMethodIterator *iterator, ObjcMethod *objc_method);
+void swift_type_iterator_init(SwiftTypeIterator *iterator, Objc *objc);
+int swift_type_next(SwiftTypeIterator *iterator, SwiftType *swift_type);
+
+void objc_print(Objc *objc, int methods, int limit);
+
+#endif
+
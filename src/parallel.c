@@ -0,0 +1,84 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "parallel.h"
+
+typedef struct Parallel
+{
+  ParallelWork work;
+  void *context;
+  int count;
+  int next;
+  pthread_mutex_t lock;
+} Parallel;
+
+static void *parallel_thread(void *context)
+{
+  Parallel *parallel = (Parallel *)context;
+  int index;
+
+  while (1)
+  {
+    pthread_mutex_lock(&parallel->lock);
+    index = parallel->next++;
+    pthread_mutex_unlock(&parallel->lock);
+
+    if (index >= parallel->count) { break; }
+
+    parallel->work(parallel->context, index);
+  }
+
+  return NULL;
+}
+
+int parallel_run(int count, ParallelWork work, void *context)
+{
+  pthread_t threads[PARALLEL_MAX_THREADS];
+  Parallel parallel;
+  int thread_count, started, i;
+
+  parallel.work = work;
+  parallel.context = context;
+  parallel.count = count;
+  parallel.next = 0;
+
+  pthread_mutex_init(&parallel.lock, NULL);
+
+  thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (thread_count < 1) { thread_count = 1; }
+  if (thread_count > PARALLEL_MAX_THREADS) { thread_count = PARALLEL_MAX_THREADS; }
+  if (thread_count > count) { thread_count = count; }
+
+  for (i = 0; i < thread_count; i++)
+  {
+    if (pthread_create(&threads[i], NULL, parallel_thread, &parallel) != 0) { break; }
+  }
+
+  started = i;
+
+  // If no thread could be started, do the work on this thread instead.
+  if (started == 0) { parallel_thread(&parallel); }
+
+  for (i = 0; i < started; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_mutex_destroy(&parallel.lock);
+
+  return started == 0 ? 1 : started;
+}
+
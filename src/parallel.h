@@ -0,0 +1,25 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdint.h>
+
+#define PARALLEL_MAX_THREADS 64
+
+typedef void (*ParallelWork)(void *context, int index);
+
+// Calls work for every index from 0 to count - 1, spread over one thread
+// per CPU. Returns the number of threads used once all of them are done.
+int parallel_run(int count, ParallelWork work, void *context);
+
+#endif
+
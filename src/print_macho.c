@@ -10,10 +10,29 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "code_signature.h"
+#include "dwarf.h"
+#include "function_starts.h"
 #include "macho.h"
+#include "objc.h"
+#include "resolve.h"
+#include "server.h"
 
-int parse_macho(FILE *fp)
+typedef struct Options
+{
+  int verify;
+  uint64_t *addresses;
+  int address_count;
+  const char *socket_path;
+  int objc;
+  int objc_methods;
+  int objc_limit;
+  int resolve;
+} Options;
+
+int parse_macho(FILE *fp, Options *options)
 {
   MachoHeader macho_header;
 
@@ -30,10 +49,22 @@ int parse_macho(FILE *fp)
   MachoSection macho_section;
   MachoSymtab macho_symtab;
   MachoDysymtab macho_dysymtab;
+  MachoLinkeditData macho_linkedit_data;
+  MachoDylib macho_dylib;
+  MachoRpath macho_rpath;
+  Dwarf dwarf;
+  Objc objc;
+  uint64_t *function_starts = NULL;
+  uint64_t text_address = 0;
+  uint64_t text_end = 0;
+  int function_start_count = 0;
 
   int bits = (macho_header.cpu_type & 0x01000000) == 0x01000000 ? 64 : 32;
   int i, n;
 
+  dwarf_init(&dwarf);
+  objc_init(&objc, fp, &macho_header);
+
   for (i = 0; i < macho_header.load_command_count; i++)
   {
     // printf("0x%04lx\n", ftell(fp));
@@ -49,10 +80,25 @@ int parse_macho(FILE *fp)
         macho_read_segment_load(&macho_segment_load, fp, bits);
         macho_print_segment_load(&macho_segment_load);
 
+        if (strncmp(macho_segment_load.name, "__TEXT", 16) == 0)
+        {
+          text_address = macho_segment_load.address;
+        }
+
+        objc_add_segment(&objc, &macho_segment_load);
+
         for (n = 0; n < macho_segment_load.section_count; n++)
         {
           macho_read_section(&macho_section, fp, bits);
           macho_print_section(&macho_section);
+          dwarf_add_section(&dwarf, &macho_section);
+          objc_add_section(&objc, &macho_section);
+
+          if (strncmp(macho_section.segment_name, "__TEXT", 16) == 0 &&
+              strncmp(macho_section.section_name, "__text", 16) == 0)
+          {
+            text_end = macho_section.address + macho_section.size;
+          }
         }
         break;
       case 0x00000002:
@@ -65,6 +111,57 @@ int parse_macho(FILE *fp)
         macho_read_dysymtab(&macho_dysymtab, fp);
         macho_print_dysymtab(&macho_dysymtab, fp);
         break;
+      case 0x0000000c:
+      case 0x0000000d:
+      case 0x00000020:
+      case 0x80000018:
+      case 0x8000001f:
+      case 0x80000023:
+        // LC_LOAD_DYLIB
+        // LC_ID_DYLIB
+        // LC_LAZY_LOAD_DYLIB
+        // LC_LOAD_WEAK_DYLIB
+        // LC_REEXPORT_DYLIB
+        // LC_LOAD_UPWARD_DYLIB
+        macho_read_dylib(&macho_dylib, fp, macho_load_command.size);
+        macho_print_dylib(&macho_dylib);
+        break;
+      case 0x0000001d:
+        // LC_CODE_SIGNATURE
+        macho_read_linkedit_data(&macho_linkedit_data, fp);
+        macho_print_linkedit_data(&macho_linkedit_data);
+        code_signature_print(&macho_linkedit_data, fp, options->verify);
+        break;
+      case 0x00000026:
+        // LC_FUNCTION_STARTS
+        macho_read_linkedit_data(&macho_linkedit_data, fp);
+        macho_print_linkedit_data(&macho_linkedit_data);
+
+        free(function_starts);
+        function_start_count = function_starts_read(
+          &macho_linkedit_data, fp, text_address, &function_starts);
+
+        if (function_start_count < 0)
+        {
+          printf("Error: Couldn't read function starts.\n\n");
+          function_start_count = 0;
+        }
+          else
+        {
+          function_starts_print(function_starts, function_start_count);
+        }
+        break;
+      case 0x00000029:
+        // LC_DATA_IN_CODE
+        macho_read_linkedit_data(&macho_linkedit_data, fp);
+        macho_print_linkedit_data(&macho_linkedit_data);
+        macho_print_data_in_code(&macho_linkedit_data, fp);
+        break;
+      case 0x8000001c:
+        // LC_RPATH
+        macho_read_rpath(&macho_rpath, fp, macho_load_command.size);
+        macho_print_rpath(&macho_rpath);
+        break;
       case 0x00000032:
         // build version?
         printf(" -- Build Version ? --\n");
@@ -83,35 +180,179 @@ int parse_macho(FILE *fp)
 
   printf("file offset: 0x%lx\n", ftell(fp));
 
+  if (options->address_count != 0)
+  {
+    const char *filename;
+    int line;
+
+    printf("\n -- Address Lookup --\n");
+
+    for (n = 0; n < options->address_count; n++)
+    {
+      uint64_t address = options->addresses[n];
+
+      if (dwarf_lookup(&dwarf, fp, address, &filename, &line) == 0)
+      {
+        printf("0x%lx %s:%d\n", address, filename, line);
+        continue;
+      }
+
+      // Without line info, stripped binaries still have function starts.
+      i = function_starts_find(
+        function_starts, function_start_count, text_end, address);
+
+      if (i >= 0)
+      {
+        printf("0x%lx ?? (function 0x%lx+0x%lx)\n",
+          address, function_starts[i], address - function_starts[i]);
+      }
+        else
+      {
+        printf("0x%lx ??\n", address);
+      }
+    }
+
+    printf("\n");
+  }
+
+  if (options->objc)
+  {
+    objc_print(&objc, options->objc_methods, options->objc_limit);
+  }
+
+  dwarf_free(&dwarf);
+  objc_free(&objc);
+  free(function_starts);
+
   return 0;
 }
 
 int main(int argc, char *argv[])
 {
   FILE *fp;
+  Options options;
+  char **filenames;
+  int filename_count = 0;
+  int error = 0;
+  int i;
 
   printf(
     "\nprint_macho - Copyright 2024 by Michael Kohn <mike@mikekohn.net>\n"
     "https://www.mikekohn.net/\n"
     "Version: February 4, 2024\n\n");
 
-  if (argc != 2)
+  memset(&options, 0, sizeof(options));
+
+  filenames = malloc(argc * sizeof(char *));
+  if (filenames == NULL) { exit(1); }
+
+  for (i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--verify") == 0)
+    {
+      options.verify = 1;
+    }
+      else
+    if (strcmp(argv[i], "--addr") == 0 && i + 1 < argc)
+    {
+      uint64_t *addresses = realloc(options.addresses,
+        (options.address_count + 1) * sizeof(uint64_t));
+
+      if (addresses == NULL) { break; }
+
+      options.addresses = addresses;
+      options.addresses[options.address_count++] =
+        strtoull(argv[++i], NULL, 0);
+    }
+      else
+    if (strcmp(argv[i], "--daemon") == 0 && i + 1 < argc)
+    {
+      options.socket_path = argv[++i];
+    }
+      else
+    if (strcmp(argv[i], "--resolve") == 0)
+    {
+      options.resolve = 1;
+    }
+      else
+    if (strcmp(argv[i], "--objc") == 0)
+    {
+      options.objc = 1;
+    }
+      else
+    if (strcmp(argv[i], "--objc-methods") == 0)
+    {
+      options.objc = 1;
+      options.objc_methods = 1;
+    }
+      else
+    if (strcmp(argv[i], "--objc-limit") == 0 && i + 1 < argc)
+    {
+      options.objc_limit = atoi(argv[++i]);
+    }
+      else
+    if (argv[i][0] == '-')
+    {
+      error = 1;
+      break;
+    }
+      else
+    {
+      filenames[filename_count++] = argv[i];
+    }
+  }
+
+  if (error ||
+      filename_count == 0 ||
+      (filename_count != 1 && options.socket_path == NULL))
   {
-    printf("Usage: print_macho <filename.o>\n");
+    printf(
+      "Usage: print_macho [options] <filename.o>\n"
+      "       print_macho --daemon <socket> <directory> [directory ...]\n"
+      "       print_macho --resolve <directory>\n"
+      "  --verify          Recompute code signature page hashes and compare.\n"
+      "  --addr <address>  Print file:line for an address (may be repeated).\n"
+      "  --daemon <socket> Watch directories and answer queries on a socket.\n"
+      "  --objc            List Objective-C classes and Swift types.\n"
+      "  --objc-methods    Same as --objc but also list each class's methods.\n"
+      "  --objc-limit <n>  Stop after n classes, types and methods per class.\n"
+      "  --resolve         Check undefined symbols of every binary in a tree.\n");
     exit(0);
   }
 
-  fp = fopen(argv[1], "rb");
+  if (options.socket_path != NULL)
+  {
+    error = server_run(options.socket_path, filenames, filename_count);
+
+    free(filenames);
+    free(options.addresses);
+
+    return error == 0 ? 0 : 1;
+  }
+
+  if (options.resolve)
+  {
+    error = resolve_run(filenames[0]);
+
+    free(filenames);
+    free(options.addresses);
+
+    return error == 0 ? 0 : 1;
+  }
+
+  fp = fopen(filenames[0], "rb");
 
   if (fp == NULL)
   {
-    printf("Error: Couldn't open %s\n", argv[1]);
+    printf("Error: Couldn't open %s\n", filenames[0]);
     exit(1);
   }
 
-  parse_macho(fp);
+  parse_macho(fp, &options);
 
   fclose(fp);
+  free(filenames);
+  free(options.addresses);
 
   return 0;
 }
@@ -0,0 +1,926 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "hash.h"
+#include "macho_model.h"
+#include "parallel.h"
+#include "resolve.h"
+
+// Every binary under the root is loaded in parallel, then the exported
+// symbols of all of them go into one hash table. Each binary's dylibs
+// are matched to binaries in the tree (by install name, @loader_path,
+// @executable_path, @rpath or path suffix) and its undefined symbols
+// are looked up in the dylib their library ordinal names. Dylibs that
+// aren't in the tree (/usr/lib, /System) are external and not checked.
+
+#define RESOLVE_MAX_DEPTH 64
+#define RESOLVE_MAX_REEXPORT_DEPTH 8
+
+#define N_STAB     0xe0
+#define N_PEXT     0x10
+#define N_TYPE     0x0e
+#define N_EXT      0x01
+#define N_UNDF     0x00
+#define N_WEAK_REF 0x0040
+
+#define SELF_LIBRARY_ORDINAL   0x00
+#define DYNAMIC_LOOKUP_ORDINAL 0xfe
+#define EXECUTABLE_ORDINAL     0xff
+
+#define MH_EXECUTE  2
+#define MH_DYLIB    6
+#define MH_BUNDLE   8
+#define MH_TWOLEVEL 0x80
+
+#define LC_LOAD_WEAK_DYLIB 0x80000018
+#define LC_REEXPORT_DYLIB  0x8000001f
+
+#define DEPENDENCY_EXTERNAL -1
+#define DEPENDENCY_MISSING  -2
+
+// Symbol lookups return the index of the defining binary or one of these.
+#define SYMBOL_NOT_FOUND -1
+#define SYMBOL_UNKNOWN   -2
+
+enum
+{
+  ISSUE_UNRESOLVED,
+  ISSUE_DUPLICATE,
+  ISSUE_BAD_ORDINAL,
+};
+
+typedef struct ResolveEntry
+{
+  const char *name;
+  int binary;
+  int next;
+} ResolveEntry;
+
+// Chained hash table from a name to every binary that has it.
+typedef struct ResolveTable
+{
+  ResolveEntry *entries;
+  int count;
+  int *buckets;
+  uint32_t mask;
+} ResolveTable;
+
+typedef struct ResolveIssue
+{
+  int type;
+  int symbol;
+  int dylib;
+  int first;
+  int second;
+} ResolveIssue;
+
+typedef struct ResolveBinary
+{
+  char *path;
+  MachoModel model;
+  int loaded;
+  int *dependencies;
+  ResolveIssue *issues;
+  int issue_count;
+} ResolveBinary;
+
+typedef struct Resolve
+{
+  ResolveBinary *binaries;
+  int binary_count;
+  ResolveTable exports;
+  ResolveTable files;
+} Resolve;
+
+static int table_init(ResolveTable *table, int count)
+{
+  uint32_t size = 16;
+  uint32_t n;
+
+  while (size < (uint32_t)count * 2 && size < 0x40000000) { size <<= 1; }
+
+  table->entries = malloc((count == 0 ? 1 : count) * sizeof(ResolveEntry));
+  table->buckets = malloc(size * sizeof(int));
+  table->count = 0;
+  table->mask = size - 1;
+
+  if (table->entries == NULL || table->buckets == NULL) { return -1; }
+
+  for (n = 0; n < size; n++) { table->buckets[n] = -1; }
+
+  return 0;
+}
+
+static void table_free(ResolveTable *table)
+{
+  free(table->entries);
+  free(table->buckets);
+
+  memset(table, 0, sizeof(ResolveTable));
+}
+
+// The table has to be created with room for every entry.
+static void table_add(ResolveTable *table, const char *name, int binary)
+{
+  uint32_t bucket = hash_string(name) & table->mask;
+  ResolveEntry *entry = &table->entries[table->count];
+
+  entry->name = name;
+  entry->binary = binary;
+  entry->next = table->buckets[bucket];
+
+  table->buckets[bucket] = table->count++;
+}
+
+// Returns the entry after index (or the first if index is -1) with this
+// name, or -1 when there are no more.
+static int table_find(ResolveTable *table, const char *name, int index)
+{
+  if (index < 0)
+  {
+    index = table->buckets[hash_string(name) & table->mask];
+  }
+    else
+  {
+    index = table->entries[index].next;
+  }
+
+  while (index >= 0)
+  {
+    if (strcmp(table->entries[index].name, name) == 0) { return index; }
+
+    index = table->entries[index].next;
+  }
+
+  return -1;
+}
+
+static int compare_binaries(const void *a, const void *b)
+{
+  const ResolveBinary *binary_a = (const ResolveBinary *)a;
+  const ResolveBinary *binary_b = (const ResolveBinary *)b;
+
+  return strcmp(binary_a->path, binary_b->path);
+}
+
+static const char *get_basename(const char *path)
+{
+  const char *slash = strrchr(path, '/');
+
+  return slash == NULL ? path : slash + 1;
+}
+
+static int path_ends_with(const char *path, const char *suffix)
+{
+  int path_length = strlen(path);
+  int suffix_length = strlen(suffix);
+
+  if (suffix_length == 0 || suffix_length > path_length) { return 0; }
+
+  if (suffix_length < path_length && path[path_length - suffix_length - 1] != '/')
+  {
+    return 0;
+  }
+
+  return strcmp(path + path_length - suffix_length, suffix) == 0;
+}
+
+static int is_defined_export(MachoSymbol *symbol)
+{
+  return (symbol->type & N_STAB) == 0 &&
+         (symbol->type & N_EXT) != 0 &&
+         (symbol->type & N_PEXT) == 0 &&
+         (symbol->type & N_TYPE) != N_UNDF;
+}
+
+static int is_undefined(MachoSymbol *symbol)
+{
+  // An undefined symbol with a value is a common symbol.
+  return (symbol->type & N_STAB) == 0 &&
+         (symbol->type & N_EXT) != 0 &&
+         (symbol->type & N_TYPE) == N_UNDF &&
+         symbol->value == 0;
+}
+
+static int add_binary(Resolve *resolve, const char *path)
+{
+  if ((resolve->binary_count % 256) == 0)
+  {
+    ResolveBinary *binaries = realloc(resolve->binaries,
+      (resolve->binary_count + 256) * sizeof(ResolveBinary));
+    if (binaries == NULL) { return -1; }
+
+    resolve->binaries = binaries;
+  }
+
+  ResolveBinary *binary = &resolve->binaries[resolve->binary_count];
+
+  memset(binary, 0, sizeof(ResolveBinary));
+  binary->path = strdup(path);
+
+  if (binary->path == NULL) { return -1; }
+
+  resolve->binary_count++;
+
+  return 0;
+}
+
+// Symbolic links are skipped so a framework's Versions/Current (and any
+// loop) doesn't add the same binary twice.
+static int scan_directory(Resolve *resolve, const char *directory, int depth)
+{
+  char path[PATH_MAX];
+  struct dirent *entry;
+  struct stat st;
+  DIR *dir;
+
+  if (depth > RESOLVE_MAX_DEPTH) { return 0; }
+
+  dir = opendir(directory);
+
+  if (dir == NULL)
+  {
+    printf("Error: Couldn't open directory %s\n", directory);
+    return -1;
+  }
+
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+    {
+      continue;
+    }
+
+    if (snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name) >=
+        sizeof(path))
+    {
+      continue;
+    }
+
+    if (lstat(path, &st) != 0) { continue; }
+
+    if (S_ISDIR(st.st_mode))
+    {
+      scan_directory(resolve, path, depth + 1);
+    }
+      else
+    if (S_ISREG(st.st_mode) && st.st_size >= 28)
+    {
+      if (add_binary(resolve, path) != 0) { break; }
+    }
+  }
+
+  closedir(dir);
+
+  return 0;
+}
+
+static void load_binary(void *context, int index)
+{
+  Resolve *resolve = (Resolve *)context;
+  ResolveBinary *binary = &resolve->binaries[index];
+
+  if (macho_model_load(&binary->model, binary->path) != 0) { return; }
+
+  // Object files and dSYMs don't take part in dynamic linking.
+  switch (binary->model.header.file_type)
+  {
+    case MH_EXECUTE:
+    case MH_DYLIB:
+    case MH_BUNDLE:
+      binary->loaded = 1;
+      break;
+    default:
+      macho_model_free(&binary->model);
+      break;
+  }
+}
+
+// Finds a binary in the tree at path (after resolving any ".." in it).
+static int find_path(Resolve *resolve, const char *path)
+{
+  char real_path[PATH_MAX];
+  int i;
+
+  if (realpath(path, real_path) == NULL) { return -1; }
+
+  for (i = table_find(&resolve->files, get_basename(real_path), -1);
+       i >= 0;
+       i = table_find(&resolve->files, get_basename(real_path), i))
+  {
+    int other = resolve->files.entries[i].binary;
+
+    if (strcmp(resolve->binaries[other].path, real_path) == 0) { return other; }
+  }
+
+  return -1;
+}
+
+// Replaces @loader_path or @executable_path at the start of name with
+// the directory of the binary. Since the executable that loads a dylib
+// isn't known, @executable_path is treated like @loader_path.
+static int expand_path(ResolveBinary *binary, const char *name, char *path)
+{
+  const char *rest;
+  int length;
+
+  if (strncmp(name, "@loader_path", 12) == 0)
+  {
+    rest = name + 12;
+  }
+    else
+  if (strncmp(name, "@executable_path", 16) == 0)
+  {
+    rest = name + 16;
+  }
+    else
+  {
+    return -1;
+  }
+
+  length = get_basename(binary->path) - binary->path;
+
+  if (snprintf(path, PATH_MAX, "%.*s%s", length, binary->path,
+      rest[0] == '/' ? rest + 1 : rest) >= PATH_MAX)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int find_dependency(Resolve *resolve, ResolveBinary *binary, const char *name)
+{
+  const char *basename = get_basename(name);
+  char path[PATH_MAX];
+  int i, n, other;
+
+  for (i = table_find(&resolve->files, basename, -1);
+       i >= 0;
+       i = table_find(&resolve->files, basename, i))
+  {
+    other = resolve->files.entries[i].binary;
+
+    if (resolve->binaries[other].model.install_name != NULL &&
+        strcmp(resolve->binaries[other].model.install_name, name) == 0)
+    {
+      return other;
+    }
+  }
+
+  if (expand_path(binary, name, path) == 0)
+  {
+    other = find_path(resolve, path);
+    if (other >= 0) { return other; }
+  }
+    else
+  if (strncmp(name, "@rpath/", 7) == 0)
+  {
+    for (n = 0; n < binary->model.rpath_count; n++)
+    {
+      char rpath[PATH_MAX];
+
+      if (expand_path(binary, binary->model.rpaths[n], rpath) != 0)
+      {
+        continue;
+      }
+
+      if (snprintf(path, sizeof(path), "%s/%s", rpath, name + 7) >= sizeof(path))
+      {
+        continue;
+      }
+
+      other = find_path(resolve, path);
+      if (other >= 0) { return other; }
+    }
+  }
+
+  // A dylib's @rpath can come from the executable that loads it, and an
+  // absolute install name can be installed under the root, so as a last
+  // try match the end of the path.
+  const char *suffix = name;
+
+  if (name[0] == '@')
+  {
+    suffix = strchr(name, '/');
+    if (suffix == NULL) { return DEPENDENCY_MISSING; }
+    suffix++;
+
+    while (strncmp(suffix, "../", 3) == 0) { suffix += 3; }
+  }
+
+  for (i = table_find(&resolve->files, basename, -1);
+       i >= 0;
+       i = table_find(&resolve->files, basename, i))
+  {
+    other = resolve->files.entries[i].binary;
+
+    if (path_ends_with(resolve->binaries[other].path, suffix)) { return other; }
+  }
+
+  return name[0] == '@' ? DEPENDENCY_MISSING : DEPENDENCY_EXTERNAL;
+}
+
+static void find_dependencies(void *context, int index)
+{
+  Resolve *resolve = (Resolve *)context;
+  ResolveBinary *binary = &resolve->binaries[index];
+  int n;
+
+  binary->dependencies = malloc((binary->model.dylib_count + 1) * sizeof(int));
+  if (binary->dependencies == NULL) { return; }
+
+  for (n = 0; n < binary->model.dylib_count; n++)
+  {
+    binary->dependencies[n] =
+      find_dependency(resolve, binary, binary->model.dylibs[n].name);
+  }
+}
+
+// A dylib exports a symbol if it defines it or if one of the dylibs it
+// re-exports does. Returns the binary that defines it.
+static int exports_symbol(Resolve *resolve, int index, const char *name, int depth)
+{
+  ResolveBinary *binary = &resolve->binaries[index];
+  int unknown = 0;
+  int i, n, definer;
+
+  for (i = table_find(&resolve->exports, name, -1);
+       i >= 0;
+       i = table_find(&resolve->exports, name, i))
+  {
+    if (resolve->exports.entries[i].binary == index) { return index; }
+  }
+
+  if (depth >= RESOLVE_MAX_REEXPORT_DEPTH || binary->dependencies == NULL)
+  {
+    return SYMBOL_NOT_FOUND;
+  }
+
+  for (n = 0; n < binary->model.dylib_count; n++)
+  {
+    if (binary->model.dylibs[n].type != LC_REEXPORT_DYLIB) { continue; }
+
+    int dependency = binary->dependencies[n];
+
+    if (dependency == DEPENDENCY_EXTERNAL)
+    {
+      unknown = 1;
+      continue;
+    }
+
+    if (dependency < 0) { continue; }
+
+    definer = exports_symbol(resolve, dependency, name, depth + 1);
+
+    if (definer >= 0) { return definer; }
+    if (definer == SYMBOL_UNKNOWN) { unknown = 1; }
+  }
+
+  return unknown ? SYMBOL_UNKNOWN : SYMBOL_NOT_FOUND;
+}
+
+static void add_issue(
+  ResolveBinary *binary,
+  int type,
+  int symbol,
+  int dylib,
+  int first,
+  int second)
+{
+  if ((binary->issue_count % 64) == 0)
+  {
+    ResolveIssue *issues = realloc(binary->issues,
+      (binary->issue_count + 64) * sizeof(ResolveIssue));
+    if (issues == NULL) { return; }
+
+    binary->issues = issues;
+  }
+
+  ResolveIssue *issue = &binary->issues[binary->issue_count++];
+
+  issue->type = type;
+  issue->symbol = symbol;
+  issue->dylib = dylib;
+  issue->first = first;
+  issue->second = second;
+}
+
+// Looks for a symbol in every dylib of a binary the way a flat namespace
+// lookup would. Two different binaries defining it is reported as a
+// duplicate. Reaching the same definition through an umbrella dylib and
+// the dylib it re-exports is not.
+static int find_flat(
+  Resolve *resolve,
+  ResolveBinary *binary,
+  int symbol,
+  const char *name)
+{
+  int result = SYMBOL_NOT_FOUND;
+  int n, definer;
+
+  for (n = 0; n < binary->model.dylib_count; n++)
+  {
+    int dependency = binary->dependencies[n];
+
+    if (dependency == DEPENDENCY_EXTERNAL)
+    {
+      if (result == SYMBOL_NOT_FOUND) { result = SYMBOL_UNKNOWN; }
+      continue;
+    }
+
+    if (dependency < 0) { continue; }
+
+    definer = exports_symbol(resolve, dependency, name, 0);
+
+    if (definer == SYMBOL_UNKNOWN)
+    {
+      if (result == SYMBOL_NOT_FOUND) { result = SYMBOL_UNKNOWN; }
+      continue;
+    }
+
+    if (definer < 0) { continue; }
+
+    if (result >= 0 && result != definer)
+    {
+      add_issue(binary, ISSUE_DUPLICATE, symbol, -1, result, definer);
+      break;
+    }
+
+    result = definer;
+  }
+
+  return result;
+}
+
+static int find_in_executable(Resolve *resolve, const char *name)
+{
+  int i;
+
+  for (i = table_find(&resolve->exports, name, -1);
+       i >= 0;
+       i = table_find(&resolve->exports, name, i))
+  {
+    int other = resolve->exports.entries[i].binary;
+
+    if (resolve->binaries[other].model.header.file_type == MH_EXECUTE)
+    {
+      return other;
+    }
+  }
+
+  return SYMBOL_NOT_FOUND;
+}
+
+static void resolve_symbols(void *context, int index)
+{
+  Resolve *resolve = (Resolve *)context;
+  ResolveBinary *binary = &resolve->binaries[index];
+  MachoModel *model = &binary->model;
+  int two_level = (model->header.flags & MH_TWOLEVEL) != 0;
+  int n, ordinal, result, weak;
+
+  if (binary->dependencies == NULL) { return; }
+
+  for (n = 0; n < model->symbol_count; n++)
+  {
+    MachoSymbol *symbol = &model->symbols[n];
+
+    if (!is_undefined(symbol)) { continue; }
+
+    const char *name = macho_model_symbol_name(model, symbol);
+
+    ordinal = (symbol->desc >> 8) & 0xff;
+    weak = (symbol->desc & N_WEAK_REF) != 0;
+
+    if (!two_level || ordinal == DYNAMIC_LOOKUP_ORDINAL)
+    {
+      result = find_flat(resolve, binary, n, name);
+
+      if (result == SYMBOL_NOT_FOUND && !weak)
+      {
+        add_issue(binary, ISSUE_UNRESOLVED, n, -1, -1, -1);
+      }
+
+      continue;
+    }
+
+    if (ordinal == SELF_LIBRARY_ORDINAL) { continue; }
+
+    if (ordinal == EXECUTABLE_ORDINAL)
+    {
+      if (find_in_executable(resolve, name) == SYMBOL_NOT_FOUND && !weak)
+      {
+        add_issue(binary, ISSUE_UNRESOLVED, n, -1, -1, -1);
+      }
+
+      continue;
+    }
+
+    if (ordinal > model->dylib_count)
+    {
+      add_issue(binary, ISSUE_BAD_ORDINAL, n, ordinal - 1, -1, -1);
+      continue;
+    }
+
+    int dependency = binary->dependencies[ordinal - 1];
+
+    if (dependency == DEPENDENCY_EXTERNAL) { continue; }
+
+    if (weak || model->dylibs[ordinal - 1].type == LC_LOAD_WEAK_DYLIB)
+    {
+      continue;
+    }
+
+    if (dependency == DEPENDENCY_MISSING ||
+        exports_symbol(resolve, dependency, name, 0) == SYMBOL_NOT_FOUND)
+    {
+      add_issue(binary, ISSUE_UNRESOLVED, n, ordinal - 1, -1, -1);
+      continue;
+    }
+
+    // Bound to one dylib, but another one it loads defines it too.
+    find_flat(resolve, binary, n, name);
+  }
+}
+
+static int build_tables(Resolve *resolve)
+{
+  int export_count = 0;
+  int n, i;
+
+  for (n = 0; n < resolve->binary_count; n++)
+  {
+    export_count += resolve->binaries[n].model.symbol_count;
+  }
+
+  if (table_init(&resolve->exports, export_count) != 0 ||
+      table_init(&resolve->files, resolve->binary_count * 2) != 0)
+  {
+    return -1;
+  }
+
+  for (n = 0; n < resolve->binary_count; n++)
+  {
+    MachoModel *model = &resolve->binaries[n].model;
+
+    for (i = 0; i < model->symbol_count; i++)
+    {
+      if (!is_defined_export(&model->symbols[i])) { continue; }
+
+      table_add(&resolve->exports,
+        macho_model_symbol_name(model, &model->symbols[i]), n);
+    }
+
+    table_add(&resolve->files, get_basename(resolve->binaries[n].path), n);
+
+    if (model->install_name != NULL &&
+        strcmp(get_basename(model->install_name),
+               get_basename(resolve->binaries[n].path)) != 0)
+    {
+      table_add(&resolve->files, get_basename(model->install_name), n);
+    }
+  }
+
+  return 0;
+}
+
+static const char *get_dylib_type(uint32_t type)
+{
+  switch (type)
+  {
+    case 0x00000020: return " (lazy)";
+    case 0x80000018: return " (weak)";
+    case 0x8000001f: return " (reexport)";
+    case 0x80000023: return " (upward)";
+    default: return "";
+  }
+}
+
+static int print_report(Resolve *resolve)
+{
+  int dependency_count = 0;
+  int external_count = 0;
+  int missing_count = 0;
+  int unresolved_count = 0;
+  int duplicate_count = 0;
+  int n, i;
+
+  printf(" -- Dependency Graph --\n");
+
+  for (n = 0; n < resolve->binary_count; n++)
+  {
+    ResolveBinary *binary = &resolve->binaries[n];
+    MachoModel *model = &binary->model;
+
+    printf("  %s (%s)\n", binary->path, get_file_type(model->header.file_type));
+
+    if (model->install_name != NULL)
+    {
+      printf("      install_name: %s\n", model->install_name);
+    }
+
+    for (i = 0; i < model->dylib_count; i++)
+    {
+      int dependency = binary->dependencies == NULL ?
+        DEPENDENCY_MISSING : binary->dependencies[i];
+
+      printf("    -> %s%s: ",
+        model->dylibs[i].name,
+        get_dylib_type(model->dylibs[i].type));
+
+      if (dependency == DEPENDENCY_EXTERNAL)
+      {
+        printf("external\n");
+        external_count++;
+      }
+        else
+      if (dependency == DEPENDENCY_MISSING)
+      {
+        printf("missing\n");
+
+        if (model->dylibs[i].type != LC_LOAD_WEAK_DYLIB) { missing_count++; }
+      }
+        else
+      {
+        printf("%s\n", resolve->binaries[dependency].path);
+      }
+
+      dependency_count++;
+    }
+  }
+
+  printf("\n");
+
+  printf(" -- Unresolved Symbols --\n");
+
+  for (n = 0; n < resolve->binary_count; n++)
+  {
+    ResolveBinary *binary = &resolve->binaries[n];
+    MachoModel *model = &binary->model;
+
+    for (i = 0; i < binary->issue_count; i++)
+    {
+      ResolveIssue *issue = &binary->issues[i];
+      const char *name =
+        macho_model_symbol_name(model, &model->symbols[issue->symbol]);
+
+      if (issue->type == ISSUE_UNRESOLVED)
+      {
+        printf("  %s: %s from %s\n",
+          binary->path,
+          name,
+          issue->dylib >= 0 ? model->dylibs[issue->dylib].name : "flat namespace");
+        unresolved_count++;
+      }
+        else
+      if (issue->type == ISSUE_BAD_ORDINAL)
+      {
+        printf("  %s: %s has library ordinal %d but there are only %d dylibs\n",
+          binary->path, name, issue->dylib + 1, model->dylib_count);
+        unresolved_count++;
+      }
+    }
+  }
+
+  printf("\n");
+
+  printf(" -- Duplicate Definitions --\n");
+
+  for (n = 0; n < resolve->binary_count; n++)
+  {
+    ResolveBinary *binary = &resolve->binaries[n];
+    MachoModel *model = &binary->model;
+
+    for (i = 0; i < binary->issue_count; i++)
+    {
+      ResolveIssue *issue = &binary->issues[i];
+
+      if (issue->type != ISSUE_DUPLICATE) { continue; }
+
+      printf("  %s: %s in %s and %s\n",
+        binary->path,
+        macho_model_symbol_name(model, &model->symbols[issue->symbol]),
+        resolve->binaries[issue->first].path,
+        resolve->binaries[issue->second].path);
+      duplicate_count++;
+    }
+  }
+
+  printf("\n");
+
+  printf(" -- Summary --\n");
+  printf("             binaries: %d\n", resolve->binary_count);
+  printf("         dependencies: %d\n", dependency_count);
+  printf("             external: %d\n", external_count);
+  printf("              missing: %d\n", missing_count);
+  printf("           unresolved: %d\n", unresolved_count);
+  printf("           duplicates: %d\n", duplicate_count);
+  printf("\n");
+
+  return missing_count + unresolved_count + duplicate_count;
+}
+
+static void resolve_free(Resolve *resolve)
+{
+  int n;
+
+  for (n = 0; n < resolve->binary_count; n++)
+  {
+    ResolveBinary *binary = &resolve->binaries[n];
+
+    free(binary->path);
+    free(binary->dependencies);
+    free(binary->issues);
+    macho_model_free(&binary->model);
+  }
+
+  free(resolve->binaries);
+  table_free(&resolve->exports);
+  table_free(&resolve->files);
+
+}
+
+// Returns the number of problems found or -1 if the tree couldn't be
+// read.
+int resolve_run(const char *root)
+{
+  char real_root[PATH_MAX];
+  Resolve resolve;
+  int count = 0;
+  int n, problems;
+
+  memset(&resolve, 0, sizeof(resolve));
+
+  // Paths are kept canonical so @loader_path can be matched by name.
+  if (realpath(root, real_root) == NULL)
+  {
+    printf("Error: Couldn't open %s\n", root);
+    resolve_free(&resolve);
+    return -1;
+  }
+
+  if (scan_directory(&resolve, real_root, 0) != 0)
+  {
+    resolve_free(&resolve);
+    return -1;
+  }
+
+  parallel_run(resolve.binary_count, load_binary, &resolve);
+
+  // Keep only the binaries that loaded so they can be indexed directly.
+  for (n = 0; n < resolve.binary_count; n++)
+  {
+    if (resolve.binaries[n].loaded)
+    {
+      resolve.binaries[count++] = resolve.binaries[n];
+    }
+      else
+    {
+      free(resolve.binaries[n].path);
+    }
+  }
+
+  resolve.binary_count = count;
+
+  // Directory order isn't stable, so sort to make reports comparable.
+  if (count > 1)
+  {
+    qsort(resolve.binaries, count, sizeof(ResolveBinary), compare_binaries);
+  }
+
+  if (build_tables(&resolve) != 0)
+  {
+    printf("Error: Out of memory.\n");
+    resolve_free(&resolve);
+    return -1;
+  }
+
+  // Dependencies of every binary are needed before any symbols can be
+  // resolved since re-exports are followed.
+  parallel_run(resolve.binary_count, find_dependencies, &resolve);
+  parallel_run(resolve.binary_count, resolve_symbols, &resolve);
+
+  problems = print_report(&resolve);
+
+  resolve_free(&resolve);
+
+  return problems;
+}
+
@@ -0,0 +1,17 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+int resolve_run(const char *root);
+
+#endif
+
@@ -0,0 +1,1133 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/inotify.h>
+
+#include "function_starts.h"
+#include "hash.h"
+#include "macho_model.h"
+#include "server.h"
+
+// Requests are single lines sent over the UNIX socket. Each response is
+// zero or more lines followed by "OK" or "ERROR <message>".
+//
+//   LIST                  All loaded files and their file type.
+//   INFO <path>           Header, segments and sections of a file.
+//   SYMBOLS <path>        Symbol table of a file.
+//   FIND <symbol>         Files that export a symbol.
+//   ADDR <path> <address> Nearest symbol and function start.
+//   QUIT                  Close the connection.
+
+#define SERVER_HASH_SIZE 4096
+#define SERVER_MAX_CLIENTS 64
+#define SERVER_LINE_SIZE 4096
+
+// Requests from a client aren't handled while this much of its output
+// is waiting to be sent, so a client that doesn't read can't stall the
+// server or make it buffer without limit.
+#define SERVER_OUTPUT_LIMIT (1024 * 1024)
+
+// An exported symbol in the name index used by FIND. Entries are owned
+// by their file and doubly linked so a file can be unindexed quickly.
+typedef struct ServerSymbol
+{
+  const char *name;
+  uint32_t hash;
+  uint64_t value;
+  struct ServerFile *file;
+  struct ServerSymbol *next;
+  struct ServerSymbol *prev;
+} ServerSymbol;
+
+typedef struct ServerFile
+{
+  char *path;
+  MachoModel model;
+  struct timespec mtime;
+  off_t size;
+  ServerSymbol *exports;
+  int export_count;
+  struct ServerFile *next;
+} ServerFile;
+
+typedef struct ServerWatch
+{
+  int wd;
+  char *directory;
+} ServerWatch;
+
+typedef struct Response
+{
+  char *data;
+  int length;
+  int allocated;
+} Response;
+
+typedef struct ServerClient
+{
+  int fd;
+  int length;
+  char buffer[SERVER_LINE_SIZE];
+  Response output;
+  int sent;
+  int closing;
+} ServerClient;
+
+typedef struct Server
+{
+  int inotify_fd;
+  int listen_fd;
+  ServerWatch *watches;
+  int watch_count;
+  ServerFile *files[SERVER_HASH_SIZE];
+  int file_count;
+  ServerSymbol **symbols;
+  uint32_t symbol_mask;
+  int symbol_count;
+  ServerClient clients[SERVER_MAX_CLIENTS];
+  int client_count;
+} Server;
+
+static volatile sig_atomic_t server_running = 1;
+
+static void server_signal(int signal_number)
+{
+  server_running = 0;
+}
+
+static uint32_t hash_path(const char *path)
+{
+  return hash_string(path) % SERVER_HASH_SIZE;
+}
+
+// External (N_EXT) and defined (N_TYPE isn't N_UNDF), not a debug stab.
+static int is_export(MachoSymbol *symbol)
+{
+  return (symbol->type & 0xe0) == 0 &&
+         (symbol->type & 0x01) != 0 &&
+         (symbol->type & 0x0e) != 0;
+}
+
+static void link_symbol(Server *server, ServerSymbol *symbol)
+{
+  ServerSymbol **bucket = &server->symbols[symbol->hash & server->symbol_mask];
+
+  symbol->prev = NULL;
+  symbol->next = *bucket;
+
+  if (*bucket != NULL) { (*bucket)->prev = symbol; }
+
+  *bucket = symbol;
+}
+
+// The index doubles in size to keep chains short as files are loaded.
+static int grow_symbols(Server *server, int count)
+{
+  uint32_t size = server->symbol_mask + 1;
+  uint32_t n;
+
+  if (server->symbols != NULL && server->symbol_count + count <= size * 2)
+  {
+    return 0;
+  }
+
+  if (server->symbols == NULL) { size = 4096; }
+
+  while (server->symbol_count + count > size * 2) { size <<= 1; }
+
+  ServerSymbol **old_symbols = server->symbols;
+  uint32_t old_size = server->symbol_mask + 1;
+
+  server->symbols = calloc(size, sizeof(ServerSymbol *));
+
+  if (server->symbols == NULL)
+  {
+    server->symbols = old_symbols;
+    return -1;
+  }
+
+  server->symbol_mask = size - 1;
+
+  if (old_symbols == NULL) { return 0; }
+
+  for (n = 0; n < old_size; n++)
+  {
+    ServerSymbol *symbol = old_symbols[n];
+
+    while (symbol != NULL)
+    {
+      ServerSymbol *next = symbol->next;
+      link_symbol(server, symbol);
+      symbol = next;
+    }
+  }
+
+  free(old_symbols);
+
+  return 0;
+}
+
+static void index_file(Server *server, ServerFile *file)
+{
+  MachoModel *model = &file->model;
+  int count = 0;
+  int n;
+
+  for (n = 0; n < model->symbol_count; n++)
+  {
+    if (is_export(&model->symbols[n])) { count++; }
+  }
+
+  if (count == 0 || grow_symbols(server, count) != 0) { return; }
+
+  file->exports = malloc(count * sizeof(ServerSymbol));
+  if (file->exports == NULL) { return; }
+
+  for (n = 0; n < model->symbol_count; n++)
+  {
+    if (!is_export(&model->symbols[n])) { continue; }
+
+    ServerSymbol *symbol = &file->exports[file->export_count++];
+
+    symbol->name = macho_model_symbol_name(model, &model->symbols[n]);
+    symbol->hash = hash_string(symbol->name);
+    symbol->value = model->symbols[n].value;
+    symbol->file = file;
+
+    link_symbol(server, symbol);
+  }
+
+  server->symbol_count += file->export_count;
+}
+
+static void unindex_file(Server *server, ServerFile *file)
+{
+  int n;
+
+  for (n = 0; n < file->export_count; n++)
+  {
+    ServerSymbol *symbol = &file->exports[n];
+
+    if (symbol->prev != NULL)
+    {
+      symbol->prev->next = symbol->next;
+    }
+      else
+    {
+      server->symbols[symbol->hash & server->symbol_mask] = symbol->next;
+    }
+
+    if (symbol->next != NULL) { symbol->next->prev = symbol->prev; }
+  }
+
+  server->symbol_count -= file->export_count;
+
+  free(file->exports);
+  file->exports = NULL;
+  file->export_count = 0;
+}
+
+static char *join_path(const char *directory, const char *name)
+{
+  char *path = malloc(strlen(directory) + strlen(name) + 2);
+
+  if (path == NULL) { return NULL; }
+
+  // realpath() leaves the trailing slash on "/" only.
+  if (directory[0] != 0 && directory[strlen(directory) - 1] == '/')
+  {
+    sprintf(path, "%s%s", directory, name);
+  }
+    else
+  {
+    sprintf(path, "%s/%s", directory, name);
+  }
+
+  return path;
+}
+
+static ServerFile *find_file(Server *server, const char *path)
+{
+  ServerFile *file = server->files[hash_path(path)];
+
+  while (file != NULL)
+  {
+    if (strcmp(file->path, path) == 0) { return file; }
+    file = file->next;
+  }
+
+  return NULL;
+}
+
+static void remove_file(Server *server, const char *path)
+{
+  ServerFile **link = &server->files[hash_path(path)];
+
+  while (*link != NULL)
+  {
+    ServerFile *file = *link;
+
+    if (strcmp(file->path, path) == 0)
+    {
+      *link = file->next;
+
+      printf("removed: %s\n", file->path);
+
+      unindex_file(server, file);
+      macho_model_free(&file->model);
+      free(file->path);
+      free(file);
+      server->file_count--;
+      return;
+    }
+
+    link = &file->next;
+  }
+}
+
+// Re-parses a file only if its size or modification time changed since
+// it was last loaded, so repeated events for one write cost one parse.
+static void update_file(Server *server, const char *path)
+{
+  ServerFile *file = find_file(server, path);
+  MachoModel model;
+  struct stat st;
+
+  if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    if (file != NULL) { remove_file(server, path); }
+    return;
+  }
+
+  if (file != NULL &&
+      file->size == st.st_size &&
+      file->mtime.tv_sec == st.st_mtim.tv_sec &&
+      file->mtime.tv_nsec == st.st_mtim.tv_nsec)
+  {
+    return;
+  }
+
+  if (macho_model_load(&model, path) != 0)
+  {
+    if (file != NULL) { remove_file(server, path); }
+    return;
+  }
+
+  if (file == NULL)
+  {
+    uint32_t hash = hash_path(path);
+
+    file = calloc(1, sizeof(ServerFile));
+    if (file == NULL) { macho_model_free(&model); return; }
+
+    file->path = strdup(path);
+    file->next = server->files[hash];
+    server->files[hash] = file;
+    server->file_count++;
+
+    printf("loaded: %s\n", path);
+  }
+    else
+  {
+    unindex_file(server, file);
+    macho_model_free(&file->model);
+
+    printf("reloaded: %s\n", path);
+  }
+
+  file->model = model;
+  index_file(server, file);
+  file->size = st.st_size;
+  file->mtime = st.st_mtim;
+
+  fflush(stdout);
+}
+
+static void scan_directory(Server *server, const char *directory)
+{
+  struct dirent *entry;
+  DIR *dir;
+
+  dir = opendir(directory);
+  if (dir == NULL) { return; }
+
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (entry->d_name[0] == '.') { continue; }
+
+    char *path = join_path(directory, entry->d_name);
+    if (path == NULL) { continue; }
+
+    update_file(server, path);
+    free(path);
+  }
+
+  closedir(dir);
+}
+
+// Copies the paths of the loaded files directly in directory (or all of
+// them if directory is NULL) so the table can change while they're used.
+static char **collect_paths(Server *server, const char *directory, int *count)
+{
+  char **paths = malloc((server->file_count + 1) * sizeof(char *));
+  int length = directory == NULL ? 0 : strlen(directory);
+  ServerFile *file;
+  int n;
+
+  *count = 0;
+
+  if (paths == NULL) { return NULL; }
+
+  for (n = 0; n < SERVER_HASH_SIZE; n++)
+  {
+    for (file = server->files[n]; file != NULL; file = file->next)
+    {
+      if (directory != NULL &&
+          (strncmp(file->path, directory, length) != 0 ||
+           file->path[length] != '/' ||
+           strchr(file->path + length + 1, '/') != NULL))
+      {
+        continue;
+      }
+
+      paths[*count] = strdup(file->path);
+      if (paths[*count] != NULL) { (*count)++; }
+    }
+  }
+
+  return paths;
+}
+
+static void free_paths(char **paths, int count)
+{
+  int n;
+
+  for (n = 0; n < count; n++) { free(paths[n]); }
+
+  free(paths);
+}
+
+// After the inotify queue overflows events were lost, so every loaded
+// file is checked again and every directory is scanned for new ones.
+static void rescan(Server *server)
+{
+  char **paths;
+  int count, n;
+
+  paths = collect_paths(server, NULL, &count);
+
+  for (n = 0; n < count; n++) { update_file(server, paths[n]); }
+
+  free_paths(paths, count);
+
+  for (n = 0; n < server->watch_count; n++)
+  {
+    scan_directory(server, server->watches[n].directory);
+  }
+}
+
+// The directory was deleted (or its watch went away), so forget it and
+// everything loaded from it.
+static void remove_watch(Server *server, int index)
+{
+  char **paths;
+  int count, n;
+
+  paths = collect_paths(server, server->watches[index].directory, &count);
+
+  for (n = 0; n < count; n++) { remove_file(server, paths[n]); }
+
+  free_paths(paths, count);
+
+  free(server->watches[index].directory);
+
+  server->watches[index] = server->watches[server->watch_count - 1];
+  server->watch_count--;
+}
+
+static int add_directory(Server *server, const char *name)
+{
+  char *directory;
+  int wd;
+
+  // Files are keyed by absolute path so "d/", "./d" and "/tmp/d" all
+  // name the same file and clients don't depend on the daemon's cwd.
+  directory = realpath(name, NULL);
+
+  if (directory == NULL)
+  {
+    printf("Error: Couldn't watch %s: %s\n", name, strerror(errno));
+    return -1;
+  }
+
+  wd = inotify_add_watch(server->inotify_fd, directory,
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF);
+
+  if (wd < 0)
+  {
+    printf("Error: Couldn't watch %s: %s\n", name, strerror(errno));
+    free(directory);
+    return -1;
+  }
+
+  ServerWatch *watches = realloc(server->watches,
+    (server->watch_count + 1) * sizeof(ServerWatch));
+
+  if (watches == NULL)
+  {
+    free(directory);
+    return -1;
+  }
+
+  server->watches = watches;
+  server->watches[server->watch_count].wd = wd;
+  server->watches[server->watch_count].directory = directory;
+  server->watch_count++;
+
+  scan_directory(server, directory);
+
+  return 0;
+}
+
+static void handle_inotify(Server *server)
+{
+  char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+  ssize_t length;
+  char *ptr;
+  int n;
+
+  length = read(server->inotify_fd, buffer, sizeof(buffer));
+  if (length <= 0) { return; }
+
+  for (ptr = buffer; ptr < buffer + length;
+       ptr += sizeof(struct inotify_event) + ((struct inotify_event *)ptr)->len)
+  {
+    const struct inotify_event *event = (const struct inotify_event *)ptr;
+    const char *directory = NULL;
+
+    // The event queue overflowed (wd is -1) and changes were lost.
+    if ((event->mask & IN_Q_OVERFLOW) != 0)
+    {
+      printf("event queue overflowed, rescanning\n");
+      rescan(server);
+      continue;
+    }
+
+    for (n = 0; n < server->watch_count; n++)
+    {
+      if (server->watches[n].wd == event->wd)
+      {
+        directory = server->watches[n].directory;
+        break;
+      }
+    }
+
+    if (directory == NULL) { continue; }
+
+    if ((event->mask & (IN_DELETE_SELF | IN_IGNORED)) != 0)
+    {
+      printf("directory removed: %s\n", directory);
+      remove_watch(server, n);
+      continue;
+    }
+
+    if (event->len == 0 || event->name[0] == '.') { continue; }
+
+    char *path = join_path(directory, event->name);
+    if (path == NULL) { continue; }
+
+    if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0)
+    {
+      update_file(server, path);
+    }
+      else
+    if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+    {
+      remove_file(server, path);
+    }
+
+    free(path);
+  }
+
+  fflush(stdout);
+}
+
+static void response_printf(Response *response, const char *format, ...)
+{
+  va_list args;
+  int length;
+
+  while (1)
+  {
+    va_start(args, format);
+    length = vsnprintf(response->data + response->length,
+      response->allocated - response->length, format, args);
+    va_end(args);
+
+    if (length < 0) { return; }
+    if (response->length + length < response->allocated) { break; }
+
+    int size = (response->allocated + length + 1) * 2;
+    char *data = realloc(response->data, size);
+
+    if (data == NULL) { return; }
+
+    response->data = data;
+    response->allocated = size;
+  }
+
+  response->length += length;
+}
+
+static void request_list(Server *server, Response *response)
+{
+  ServerFile *file;
+  int n;
+
+  for (n = 0; n < SERVER_HASH_SIZE; n++)
+  {
+    for (file = server->files[n]; file != NULL; file = file->next)
+    {
+      response_printf(response, "%s %d (%s)\n",
+        file->path,
+        file->model.header.file_type,
+        get_file_type(file->model.header.file_type));
+    }
+  }
+
+  response_printf(response, "OK\n");
+}
+
+static void request_info(ServerFile *file, Response *response)
+{
+  MachoModel *model = &file->model;
+  int n;
+
+  response_printf(response, "cpu_type 0x%x %s%s\n",
+    model->header.cpu_type,
+    get_cpu_type(model->header.cpu_type),
+    model->bits == 64 ? " 64bit" : "");
+  response_printf(response, "file_type %d %s\n",
+    model->header.file_type,
+    get_file_type(model->header.file_type));
+  response_printf(response, "symbols %d\n", model->symbol_count);
+  response_printf(response, "function_starts %d\n", model->function_start_count);
+
+  for (n = 0; n < model->segment_count; n++)
+  {
+    response_printf(response, "segment %.16s 0x%lx %ld 0x%lx %ld\n",
+      model->segments[n].name,
+      model->segments[n].address,
+      model->segments[n].address_size,
+      model->segments[n].file_offset,
+      model->segments[n].file_size);
+  }
+
+  for (n = 0; n < model->section_count; n++)
+  {
+    response_printf(response, "section %.16s,%.16s 0x%lx %ld %d\n",
+      model->sections[n].segment_name,
+      model->sections[n].section_name,
+      model->sections[n].address,
+      model->sections[n].size,
+      model->sections[n].offset);
+  }
+
+  response_printf(response, "OK\n");
+}
+
+static void request_symbols(ServerFile *file, Response *response)
+{
+  MachoModel *model = &file->model;
+  int n;
+
+  for (n = 0; n < model->symbol_count; n++)
+  {
+    response_printf(response, "0x%08lx 0x%02x %s\n",
+      model->symbols[n].value,
+      model->symbols[n].type,
+      macho_model_symbol_name(model, &model->symbols[n]));
+  }
+
+  response_printf(response, "OK\n");
+}
+
+static void request_find(Server *server, const char *name, Response *response)
+{
+  uint32_t hash = hash_string(name);
+  ServerSymbol *symbol;
+
+  if (server->symbols != NULL)
+  {
+    for (symbol = server->symbols[hash & server->symbol_mask];
+         symbol != NULL;
+         symbol = symbol->next)
+    {
+      if (symbol->hash != hash || strcmp(symbol->name, name) != 0) { continue; }
+
+      response_printf(response, "%s 0x%lx\n", symbol->file->path, symbol->value);
+    }
+  }
+
+  response_printf(response, "OK\n");
+}
+
+static void request_addr(ServerFile *file, uint64_t address, Response *response)
+{
+  MachoModel *model = &file->model;
+  MachoSymbol *nearest = NULL;
+  uint64_t text_end = 0;
+  int n;
+
+  for (n = 0; n < model->symbol_count; n++)
+  {
+    MachoSymbol *symbol = &model->symbols[n];
+
+    // Only symbols defined in a section (N_SECT) that aren't debug stabs.
+    if ((symbol->type & 0xe0) != 0 || (symbol->type & 0x0e) != 0x0e) { continue; }
+    if (symbol->value > address) { continue; }
+
+    if (nearest == NULL || symbol->value > nearest->value) { nearest = symbol; }
+  }
+
+  if (nearest != NULL)
+  {
+    response_printf(response, "symbol %s+0x%lx\n",
+      macho_model_symbol_name(model, nearest),
+      address - nearest->value);
+  }
+
+  for (n = 0; n < model->section_count; n++)
+  {
+    MachoSection *section = &model->sections[n];
+
+    if (strncmp(section->segment_name, "__TEXT", 16) == 0 &&
+        strncmp(section->section_name, "__text", 16) == 0)
+    {
+      text_end = section->address + section->size;
+      break;
+    }
+  }
+
+  n = function_starts_find(
+    model->function_starts,
+    model->function_start_count,
+    text_end,
+    address);
+
+  if (n >= 0)
+  {
+    response_printf(response, "function 0x%lx+0x%lx\n",
+      model->function_starts[n],
+      address - model->function_starts[n]);
+  }
+
+  response_printf(response, "OK\n");
+}
+
+// Appends the response to the client's output. Returns -1 when the
+// client asked to close the connection.
+static int handle_request(Server *server, Response *response, char *line)
+{
+  char *command, *argument, *context = NULL;
+
+  command = strtok_r(line, " \t\r", &context);
+  argument = strtok_r(NULL, " \t\r", &context);
+
+  if (command == NULL)
+  {
+    response_printf(response, "ERROR empty request\n");
+  }
+    else
+  if (strcmp(command, "QUIT") == 0)
+  {
+    return -1;
+  }
+    else
+  if (strcmp(command, "LIST") == 0)
+  {
+    request_list(server, response);
+  }
+    else
+  if (strcmp(command, "FIND") == 0 && argument != NULL)
+  {
+    request_find(server, argument, response);
+  }
+    else
+  if (strcmp(command, "INFO") == 0 ||
+      strcmp(command, "SYMBOLS") == 0 ||
+      strcmp(command, "ADDR") == 0)
+  {
+    ServerFile *file = argument == NULL ? NULL : find_file(server, argument);
+
+    if (file == NULL)
+    {
+      response_printf(response, "ERROR file not loaded\n");
+    }
+      else
+    if (strcmp(command, "INFO") == 0)
+    {
+      request_info(file, response);
+    }
+      else
+    if (strcmp(command, "SYMBOLS") == 0)
+    {
+      request_symbols(file, response);
+    }
+      else
+    {
+      char *address = strtok_r(NULL, " \t\r", &context);
+
+      if (address == NULL)
+      {
+        response_printf(response, "ERROR missing address\n");
+      }
+        else
+      {
+        request_addr(file, strtoull(address, NULL, 0), response);
+      }
+    }
+  }
+    else
+  {
+    response_printf(response, "ERROR unknown request\n");
+  }
+
+  return 0;
+}
+
+static void close_client(Server *server, int index)
+{
+  close(server->clients[index].fd);
+  free(server->clients[index].output.data);
+
+  server->clients[index] = server->clients[server->client_count - 1];
+  server->client_count--;
+}
+
+// Handles complete lines in the client's buffer until its pending output
+// reaches SERVER_OUTPUT_LIMIT. The rest wait until the output is sent.
+static void process_requests(Server *server, ServerClient *client)
+{
+  char *end;
+
+  while (client->closing == 0 &&
+         client->output.length < SERVER_OUTPUT_LIMIT &&
+         (end = strchr(client->buffer, '\n')) != NULL)
+  {
+    *end = 0;
+
+    if (handle_request(server, &client->output, client->buffer) != 0)
+    {
+      client->closing = 1;
+    }
+
+    client->length -= (end + 1) - client->buffer;
+    memmove(client->buffer, end + 1, client->length + 1);
+  }
+
+  if (client->length == sizeof(client->buffer) - 1 &&
+      strchr(client->buffer, '\n') == NULL)
+  {
+    response_printf(&client->output, "ERROR request too long\n");
+    client->length = 0;
+    client->buffer[0] = 0;
+  }
+}
+
+// Writes as much pending output as the socket takes without blocking.
+static int flush_client(ServerClient *client)
+{
+  Response *output = &client->output;
+
+  while (client->sent < output->length)
+  {
+    ssize_t count = write(client->fd,
+      output->data + client->sent,
+      output->length - client->sent);
+
+    if (count < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) { return 0; }
+      return -1;
+    }
+
+    client->sent += count;
+  }
+
+  output->length = 0;
+  client->sent = 0;
+
+  // Don't hold on to the buffer of a large response while idle.
+  if (output->allocated > 65536)
+  {
+    free(output->data);
+    output->data = NULL;
+    output->allocated = 0;
+  }
+
+  return 0;
+}
+
+static void service_client(Server *server, int index)
+{
+  ServerClient *client = &server->clients[index];
+
+  while (1)
+  {
+    process_requests(server, client);
+
+    if (flush_client(client) != 0)
+    {
+      close_client(server, index);
+      return;
+    }
+
+    // Wait for POLLOUT before handling anything else.
+    if (client->output.length != 0) { return; }
+
+    if (client->closing)
+    {
+      close_client(server, index);
+      return;
+    }
+
+    if (strchr(client->buffer, '\n') == NULL) { return; }
+  }
+}
+
+static void handle_client(Server *server, int index)
+{
+  ServerClient *client = &server->clients[index];
+  ssize_t count;
+
+  count = read(client->fd,
+    client->buffer + client->length,
+    sizeof(client->buffer) - client->length - 1);
+
+  if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+  {
+    return;
+  }
+
+  if (count <= 0)
+  {
+    close_client(server, index);
+    return;
+  }
+
+  client->length += count;
+  client->buffer[client->length] = 0;
+
+  service_client(server, index);
+}
+
+static void handle_connect(Server *server)
+{
+  int fd = accept(server->listen_fd, NULL, NULL);
+
+  if (fd < 0) { return; }
+
+  // Responses are written as the client takes them, never blocking.
+  if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+  {
+    close(fd);
+    return;
+  }
+
+  if (server->client_count == SERVER_MAX_CLIENTS)
+  {
+    close(fd);
+    return;
+  }
+
+  memset(&server->clients[server->client_count], 0, sizeof(ServerClient));
+  server->clients[server->client_count].fd = fd;
+  server->client_count++;
+}
+
+static int open_socket(const char *socket_path)
+{
+  struct sockaddr_un address;
+  struct stat st;
+  int fd;
+
+  if (strlen(socket_path) >= sizeof(address.sun_path))
+  {
+    printf("Error: Socket path %s is too long.\n", socket_path);
+    return -1;
+  }
+
+  // Only an old socket is replaced, never a regular file.
+  if (stat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+  {
+    unlink(socket_path);
+  }
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) { return -1; }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_path);
+
+  if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(fd, 16) != 0)
+  {
+    printf("Error: Couldn't listen on %s: %s\n", socket_path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static void server_free(Server *server)
+{
+  ServerFile *file, *next;
+  int n;
+
+  for (n = 0; n < server->client_count; n++)
+  {
+    close(server->clients[n].fd);
+    free(server->clients[n].output.data);
+  }
+
+  for (n = 0; n < SERVER_HASH_SIZE; n++)
+  {
+    for (file = server->files[n]; file != NULL; file = next)
+    {
+      next = file->next;
+      free(file->exports);
+      macho_model_free(&file->model);
+      free(file->path);
+      free(file);
+    }
+  }
+
+  for (n = 0; n < server->watch_count; n++) { free(server->watches[n].directory); }
+
+  free(server->watches);
+  free(server->symbols);
+
+  if (server->inotify_fd >= 0) { close(server->inotify_fd); }
+  if (server->listen_fd >= 0) { close(server->listen_fd); }
+}
+
+int server_run(const char *socket_path, char **directories, int directory_count)
+{
+  struct pollfd fds[SERVER_MAX_CLIENTS + 2];
+  struct sigaction action;
+  Server *server;
+  int n;
+
+  server = calloc(1, sizeof(Server));
+  if (server == NULL) { return -1; }
+
+  server->listen_fd = -1;
+  server->inotify_fd = inotify_init1(IN_CLOEXEC);
+
+  if (server->inotify_fd < 0)
+  {
+    printf("Error: inotify_init1() failed: %s\n", strerror(errno));
+    server_free(server);
+    free(server);
+    return -1;
+  }
+
+  for (n = 0; n < directory_count; n++)
+  {
+    add_directory(server, directories[n]);
+  }
+
+  server->listen_fd = open_socket(socket_path);
+
+  if (server->listen_fd < 0)
+  {
+    server_free(server);
+    free(server);
+    return -1;
+  }
+
+  // No SA_RESTART, so a signal wakes up poll() and the loop can exit.
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = server_signal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("watching %d files, listening on %s\n", server->file_count, socket_path);
+  fflush(stdout);
+
+  while (server_running)
+  {
+    fds[0].fd = server->inotify_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = server->listen_fd;
+    fds[1].events = POLLIN;
+
+    // A client with output waiting only gets more requests read once
+    // it's all sent.
+    for (n = 0; n < server->client_count; n++)
+    {
+      fds[n + 2].fd = server->clients[n].fd;
+      fds[n + 2].events =
+        server->clients[n].output.length != 0 ? POLLOUT : POLLIN;
+    }
+
+    int count = server->client_count;
+
+    if (poll(fds, count + 2, -1) < 0)
+    {
+      if (errno == EINTR) { continue; }
+      break;
+    }
+
+    if ((fds[0].revents & POLLIN) != 0) { handle_inotify(server); }
+
+    // Clients are walked backwards since closing one moves the last
+    // client into its slot.
+    for (n = count - 1; n >= 0; n--)
+    {
+      if ((fds[n + 2].revents & POLLOUT) != 0)
+      {
+        service_client(server, n);
+      }
+        else
+      if ((fds[n + 2].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+      {
+        handle_client(server, n);
+      }
+    }
+
+    if ((fds[1].revents & POLLIN) != 0) { handle_connect(server); }
+  }
+
+  unlink(socket_path);
+  server_free(server);
+  free(server);
+
+  return 0;
+}
+
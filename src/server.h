@@ -0,0 +1,17 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+int server_run(const char *socket_path, char **directories, int directory_count);
+
+#endif
+
@@ -0,0 +1,221 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "sha.h"
+
+#define ROTL(a, n) (((a) << (n)) | ((a) >> (32 - (n))))
+#define ROTR(a, n) (((a) >> (n)) | ((a) << (32 - (n))))
+
+static const uint32_t sha256_k[64] =
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t get_uint32_be(const uint8_t *data)
+{
+  return ((uint32_t)data[0] << 24) |
+         ((uint32_t)data[1] << 16) |
+         ((uint32_t)data[2] << 8) |
+          (uint32_t)data[3];
+}
+
+static void put_uint32_be(uint8_t *data, uint32_t value)
+{
+  data[0] = value >> 24;
+  data[1] = (value >> 16) & 0xff;
+  data[2] = (value >> 8) & 0xff;
+  data[3] = value & 0xff;
+}
+
+static void sha1_block(uint32_t *h, const uint8_t *block)
+{
+  uint32_t w[80];
+  uint32_t a, b, c, d, e, f, k, temp;
+  int i;
+
+  for (i = 0; i < 16; i++) { w[i] = get_uint32_be(block + (i * 4)); }
+
+  for (i = 16; i < 80; i++)
+  {
+    w[i] = ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+
+  a = h[0];
+  b = h[1];
+  c = h[2];
+  d = h[3];
+  e = h[4];
+
+  for (i = 0; i < 80; i++)
+  {
+    if (i < 20)
+    {
+      f = (b & c) | (~b & d);
+      k = 0x5a827999;
+    }
+      else
+    if (i < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ed9eba1;
+    }
+      else
+    if (i < 60)
+    {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8f1bbcdc;
+    }
+      else
+    {
+      f = b ^ c ^ d;
+      k = 0xca62c1d6;
+    }
+
+    temp = ROTL(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = ROTL(b, 30);
+    b = a;
+    a = temp;
+  }
+
+  h[0] += a;
+  h[1] += b;
+  h[2] += c;
+  h[3] += d;
+  h[4] += e;
+}
+
+static void sha256_block(uint32_t *h, const uint8_t *block)
+{
+  uint32_t w[64];
+  uint32_t a, b, c, d, e, f, g, j, s0, s1, t1, t2;
+  int i;
+
+  for (i = 0; i < 16; i++) { w[i] = get_uint32_be(block + (i * 4)); }
+
+  for (i = 16; i < 64; i++)
+  {
+    s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  a = h[0];
+  b = h[1];
+  c = h[2];
+  d = h[3];
+  e = h[4];
+  f = h[5];
+  g = h[6];
+  j = h[7];
+
+  for (i = 0; i < 64; i++)
+  {
+    s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+    t1 = j + s1 + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+    s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+    t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+
+    j = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  h[0] += a;
+  h[1] += b;
+  h[2] += c;
+  h[3] += d;
+  h[4] += e;
+  h[5] += f;
+  h[6] += g;
+  h[7] += j;
+}
+
+// Both hashes use the same 64 byte block and padding scheme so the
+// full blocks are hashed in place and only the tail is copied.
+static void sha_run(
+  uint32_t *h,
+  void (*block)(uint32_t *h, const uint8_t *block),
+  const uint8_t *data,
+  uint64_t length)
+{
+  uint8_t tail[128];
+  uint64_t n;
+  int remain, tail_length;
+
+  for (n = 0; n + 64 <= length; n += 64)
+  {
+    block(h, data + n);
+  }
+
+  remain = length - n;
+  tail_length = remain < 56 ? 64 : 128;
+
+  memset(tail, 0, sizeof(tail));
+  memcpy(tail, data + n, remain);
+  tail[remain] = 0x80;
+
+  put_uint32_be(tail + tail_length - 8, (length * 8) >> 32);
+  put_uint32_be(tail + tail_length - 4, (length * 8) & 0xffffffff);
+
+  block(h, tail);
+  if (tail_length == 128) { block(h, tail + 64); }
+}
+
+void sha1(uint8_t *digest, const uint8_t *data, uint64_t length)
+{
+  uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+  int i;
+
+  sha_run(h, sha1_block, data, length);
+
+  for (i = 0; i < 5; i++) { put_uint32_be(digest + (i * 4), h[i]); }
+}
+
+void sha256(uint8_t *digest, const uint8_t *data, uint64_t length)
+{
+  uint32_t h[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+  int i;
+
+  sha_run(h, sha256_block, data, length);
+
+  for (i = 0; i < 8; i++) { put_uint32_be(digest + (i * 4), h[i]); }
+}
+
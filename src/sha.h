@@ -0,0 +1,23 @@
+/*
+  print_macho - The MachO file format analyzer.
+
+  Copyright 2024 - Michael Kohn (mike@mikekohn.net)
+  https://www.mikekohn.net/
+
+  This program falls under the MIT license.
+
+*/
+
+#ifndef SHA_H
+#define SHA_H
+
+#include <stdint.h>
+
+#define SHA1_DIGEST_SIZE 20
+#define SHA256_DIGEST_SIZE 32
+
+void sha1(uint8_t *digest, const uint8_t *data, uint64_t length);
+void sha256(uint8_t *digest, const uint8_t *data, uint64_t length);
+
+#endif
+